@@ -1,4 +1,7 @@
 import argparse
+import csv
+import json
+import re
 import serial
 import sys
 import selectors
@@ -15,13 +18,64 @@ _OPENOCD_ARGS = [
 
 def parse_args():
     parser = argparse.ArgumentParser(description="Connect to a UART device via pyserial.")
-    parser.add_argument("-d", "--device", type=str, required=True, help="The UART device (e.g. /dev/ttyACM0)")
+    parser.add_argument("-d", "--device", type=str, required=True, help="The UART device (e.g. /dev/ttyACM0), or - for stdin (make qemu)")
     parser.add_argument("-b", "--baudrate", type=int, required=True, help="Baud rate for the UART connection (e.g. 115200)")
     parser.add_argument("-l", "--logfile", type=str, required=True, help="File for openocd console logs")
     parser.add_argument("-t", "--timeout", type=int, default=1, help="Timeout value for initial UART connection")
+    parser.add_argument("-r", "--report", type=str, help="Collect @bench records into this .csv or .json file, then exit")
     return parser.parse_args()
 
 
+# e.g. "@bench name=isr_mti runs=200 cycles=41/42/60 instret=20/20/20",
+# see kernel/bench.h
+_BENCH_RE = re.compile(r"^@bench name=(\S+) runs=(\d+) cycles=(\d+)/(\d+)/(\d+) instret=(\d+)/(\d+)/(\d+)$")
+_BENCH_DONE = "@bench-done"
+_BENCH_FIELDS = [
+    "name", "runs",
+    "cycles_min", "cycles_median", "cycles_max",
+    "instret_min", "instret_median", "instret_max",
+]
+
+
+def parse_bench(line):
+    """Returns the record in a @bench line as a dict, or None."""
+    m = _BENCH_RE.match(line.strip())
+    if not m:
+        return None
+    values = m.groups()
+    return {"name": values[0], **{k: int(v) for k, v in zip(_BENCH_FIELDS[1:], values[1:])}}
+
+
+def write_report(records, path):
+    with open(path, "w", newline="") as f:
+        if path.endswith(".json"):
+            json.dump(records, f, indent=2)
+            f.write("\n")
+        else:
+            writer = csv.DictWriter(f, fieldnames=_BENCH_FIELDS)
+            writer.writeheader()
+            writer.writerows(records)
+
+
+def collect(conn, path, _output=sys.stdout, stop_on_eof=False):
+    records = []
+    while True:
+        raw = conn.readline()
+        if not raw and stop_on_eof:
+            break
+        line = raw.decode("utf-8", errors="ignore").strip()
+        if not line:
+            continue
+        print(line, flush=True, file=_output)
+        if line == _BENCH_DONE:
+            break
+        record = parse_bench(line)
+        if record:
+            records.append(record)
+    write_report(records, path)
+    print(f"Wrote {len(records)} records to {path}", file=_output)
+
+
 def connect_openocd(logfile):
     with open(logfile, "w") as f:
         process = subprocess.Popen(_OPENOCD_ARGS, stdout=f, stderr=f)
@@ -60,12 +114,22 @@ def repl(conn, _input=sys.stdin, _output=sys.stdout):
 
 def main():
     args = parse_args()
-    
+
+    # QEMU output piped in, there is no board to attach to
+    if args.device == "-":
+        if not args.report:
+            sys.exit("--device=- needs --report")
+        collect(sys.stdin.buffer, args.report, stop_on_eof=True)
+        return
+
     cb = connect_openocd(args.logfile)
 
     uart = serial.Serial(args.device, args.baudrate, timeout=args.timeout)
     uart.flush()
-    repl(uart)
+    if args.report:
+        collect(uart, args.report)
+    else:
+        repl(uart)
     uart.close()
 
     cb()
@@ -0,0 +1,106 @@
+/**
+ * @file host.h
+ * @brief Emulated RP2350 register model, for `make host`.
+ *
+ * Built with HOST, AT() and the CSR accessors route every access through
+ * host_reg and host_csr_*, so the portable drivers run unchanged as a Linux
+ * executable. The model covers what those drivers rely on:
+ *
+ * - atomic SET/CLR/XOR aliases of APB registers
+ * - RESETS: RESET_DONE follows RESET
+ * - XOSC: stable as soon as it is enabled
+ * - PLL: locked as soon as the VCO is powered
+ * - CLOCKS: glitchless muxes select whatever CTRL asks for
+ * - UART0: an unbounded TX FIFO and an RX FIFO fed by host_uart_rx,
+ *   interrupts from RIS & IMSC
+ * - SIO: mtime and MTIMECMP, and the inter-core FIFOs, with the other core
+ *   played by host_fifo_push/host_fifo_pop
+ *
+ * Any other address behaves as plain memory. mtime and mcycle advance by
+ * one on every read, so busy waits terminate; tests move time along with
+ * host_mtime_advance. Hardware spinlocks and DMA are not modelled.
+ *
+ * A returned register pointer is only valid until the next host_* call,
+ * which is when writes through it take effect.
+ *
+ * @author Herbie Rand
+ */
+
+#ifndef HOST_H
+#define HOST_H
+
+#include "types.h"
+
+/** @brief Depth of each inter-core FIFO */
+#define HOST_FIFO_DEPTH 4
+
+/**
+ * @brief Returns the model's storage for one access to a register.
+ * @param addr  Integer register address
+ */
+volatile uint32_t *host_reg(uint32_t addr);
+
+/**
+ * @brief Reads a CSR of core 0 by name, e.g. "mstatus".
+ */
+uint32_t host_csr_read(const char *name);
+
+/**
+ * @brief Writes a CSR of core 0 by name.
+ */
+void host_csr_write(const char *name, uint32_t val);
+
+/**
+ * @brief Returns all registers and CSRs to their reset values.
+ */
+void host_reset();
+
+/**
+ * @brief Takes pending, enabled interrupts, calling the kernel's handlers
+ *        as isr_mti and isr_mei would.
+ * Only UART0_IRQ and the machine timer are modelled.
+ */
+void host_poll();
+
+/**
+ * @brief Stands in for wfi: lets mtime catch up with MTIMECMP if the timer
+ *        interrupt is enabled, then calls host_poll.
+ */
+void host_wfi();
+
+/**
+ * @brief Advances mtime.
+ * @param ticks Integer number of mtime ticks
+ */
+void host_mtime_advance(uint64_t ticks);
+
+/**
+ * @brief Queues bytes in the UART0 RX FIFO, as if received on the wire.
+ */
+void host_uart_rx(const char *buf, uint32_t n);
+
+/**
+ * @brief Takes the bytes written to UART0 so far.
+ * @param buf   Buffer for up to n bytes
+ * @returns Integer number of bytes copied
+ */
+uint32_t host_uart_tx(char *buf, uint32_t n);
+
+/**
+ * @brief Pushes a word into this core's inbound FIFO, as the other core.
+ * @returns 1 on success, 0 if the FIFO is full
+ */
+uint32_t host_fifo_push(uint32_t v);
+
+/**
+ * @brief Pops a word from this core's outbound FIFO, as the other core.
+ * @returns 1 on success, 0 if the FIFO is empty
+ */
+uint32_t host_fifo_pop(uint32_t *v);
+
+/**
+ * @brief Returns the number of breakpoint() calls so far.
+ */
+uint32_t host_breakpoints();
+
+#endif
@@ -0,0 +1,587 @@
+/**
+ * @brief Unit tests and micro-benchmarks of the portable drivers, run on
+ *        the host against the register model (host.h) with `make host`.
+ *
+ * Each case starts from host_reset. Failed checks are printed and make the
+ * executable exit non-zero. Benchmarks report wall-clock nanoseconds per
+ * call, which measure the driver logic plus the model, not the target.
+ * The lock-free rings and the seqlock are also run from host threads.
+ *
+ * @author Herbie Rand
+ */
+#include "asm.h"
+#include "clock.h"
+#include "fifo.h"
+#include "host.h"
+#include "mtime.h"
+#include "pool.h"
+#include "resets.h"
+#include "ring.h"
+#include "riscv.h"
+#include "rp2350.h"
+#include "seqlock.h"
+#include "timer.h"
+#include "tlsf.h"
+#include "types.h"
+#include "uart.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define CHECK(cond)                                                            \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s: %s (%s:%d)\n", __func__, #cond, __FILE__,        \
+                   __LINE__);                                                  \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+#define BENCH_ITERS 100000
+#define POOL_N      20
+// too small to cache, see POOL_CACHE_LIMIT
+#define TINY_N      3
+#define HEAP_SIZE   8192
+#define HEAP_LIVE   64
+// threaded ring and seqlock tests, each thread stands in for a core or ISR,
+// and yields rather than spin so they also run on a single host CPU
+#define PRODUCERS   4
+#define READERS     4
+#define ITEMS       100000
+#define RING_SIZE   64
+
+typedef struct {
+    uint32_t id;
+    uint64_t pad;
+} obj_t;
+
+void isr_mtimer_irq();
+
+static uint32_t failures = 0;
+static uint32_t fired = 0;
+
+POOL_DEFINE(obj_pool, obj_t, POOL_N);
+POOL_DEFINE(tiny_pool, obj_t, TINY_N);
+
+static uint64_t heap_mem[HEAP_SIZE / 8];
+static tlsf_t heap;
+
+static mpsc_t mpsc;
+static spsc_t spsc;
+
+// seqlock-protected snapshot, torn if the words differ
+static seqlock_t snap_lock;
+static volatile uint32_t snap[4];
+static volatile uint32_t snap_done;
+
+static uint32_t _rand() {
+    static uint32_t x = 1;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+static void test_resets() {
+    initial_reset_cycle();
+    CHECK(AT(RESETS_RESET) & (1 << UART0_BLOCKNUM));
+    CHECK(!(AT(RESETS_RESET) & (1 << IO_BANK0_BLOCKNUM)));
+
+    postclk_reset_cycle();
+    CHECK(AT(RESETS_RESET) == 0);
+    CHECK(AT(RESETS_RESET_DONE) == RESET_BITS);
+}
+
+static void test_clocks() {
+    clock_defaults_set();
+    CHECK(clk_sys_freq_mhz() == 150);
+    CHECK(clk_ref_freq_mhz() == 12);
+    CHECK(AT(PLL_SYS_FBDIV_INT) == 125);
+    CHECK(AT(PLL_USB_FBDIV_INT) == 120);
+    CHECK(AT(PLL_SYS_PRIM) == ((PLL_SYS_POSTDIV1 << 16) |
+                               (PLL_SYS_POSTDIV2 << 12)));
+    // PD, POSTDIVPD and VCOPD cleared, DSMPD stays set in integer mode
+    CHECK(AT(PLL_SYS_PWR) == 0x4);
+    CHECK(AT(PLL_USB_PWR) == 0x4);
+    CHECK(AT(CLOCKS_CLK_SYS_SELECTED) == (1 << CLK_SYS_SRC_DEFAULT));
+    CHECK(AT(CLOCKS_CLK_REF_SELECTED) == (1 << CLK_REF_SRC_DEFAULT));
+    // mtime re-calibrated for the 12 MHz clk_ref
+    CHECK(AT(TICKS_RISCV_CYCLES) == 12);
+    CHECK(us_to_cycles(10) == 1500);
+    CHECK(cycles_to_us(1500) == 10);
+    // rounded down however large, e.g. just short of a whole microsecond
+    CHECK(cycles_to_us(150 * (1ull << 40) - 1) == (1ull << 40) - 1);
+    CHECK(cycles_to_us(~0ull) == ~0ull / 150);
+    CHECK(ticks_to_us(MTIME_TICKS_PER_US * (1ull << 40) - 1) ==
+          (1ull << 40) - 1);
+    CHECK(host_breakpoints() == 0);
+}
+
+static void test_uart_polled() {
+    char buf[48];
+
+    uart_init();
+    CHECK(AT(UART0_UARTCR) & UARTCR_UARTEN);
+
+    uart_write("hello", 5);
+    CHECK(host_uart_tx(buf, sizeof(buf)) == 5);
+    CHECK(!memcmp(buf, "hello", 5));
+
+    uart_puts("v=");
+    uart_putu(0);
+    uart_putc(' ');
+    uart_putu(4294967295u);
+    uart_putc(' ');
+    uart_putu64(1ull << 32);
+    uart_putc(' ');
+    uart_putu64(18446744073709551615ull);
+    CHECK(host_uart_tx(buf, sizeof(buf)) == 46);
+    CHECK(!memcmp(buf, "v=0 4294967295 4294967296 18446744073709551615", 46));
+
+    host_uart_rx("xy", 2);
+    CHECK(uart_getc() == 'x');
+    CHECK(uart_getc() == 'y');
+    CHECK(AT(UART0_UARTFR) & UARTFR_RXFE);
+}
+
+static void test_uart_irq() {
+    char buf[16];
+    uint32_t n;
+
+    uart_init();
+    uart_irq_enable(UARTIFLS_1_2, UARTIFLS_1_2);
+    set_mie(MEI_MASK);
+    set_mstatus(MIE_MASK);
+
+    host_uart_rx("abc", 3);
+    n = uart_read(buf, sizeof(buf));
+    CHECK(n == 3);
+    CHECK(!memcmp(buf, "abc", 3));
+    CHECK(uart_rx_dropped() == 0);
+
+    uart_write("0123456789", 10);
+    uart_flush();
+    CHECK(host_uart_tx(buf, sizeof(buf)) == 10);
+    CHECK(!memcmp(buf, "0123456789", 10));
+
+    // out of range trigger levels hit a breakpoint
+    uart_irq_enable(UARTIFLS_7_8 + 1, 0);
+    CHECK(host_breakpoints() == 1);
+}
+
+static void test_fifo() {
+    uint32_t v = 0;
+
+    CHECK(host_fifo_push(42));
+    CHECK(AT(SIO_FIFO_ST) & ST_VLD);
+    CHECK(multicore_fifo_pop_blocking() == 42);
+    CHECK(!(AT(SIO_FIFO_ST) & ST_VLD));
+
+    multicore_fifo_push_blocking(7);
+    CHECK(host_fifo_pop(&v) && v == 7);
+
+    // reading an empty FIFO sets ROE, which is write-one-to-clear
+    (void)AT(SIO_FIFO_RD);
+    CHECK(AT(SIO_FIFO_ST) & ST_ROE);
+    AT(SIO_FIFO_ST) = ST_ROE;
+    CHECK(!(AT(SIO_FIFO_ST) & ST_ROE));
+
+    for (uint32_t i = 0; i < HOST_FIFO_DEPTH; i++) {
+        CHECK(host_fifo_push(i));
+    }
+    CHECK(!host_fifo_push(0));
+    multicore_fifo_drain();
+    CHECK(!(AT(SIO_FIFO_ST) & ST_VLD));
+}
+
+static void test_mtimer() {
+    mtimer_enable();
+    set_mstatus(MIE_MASK);
+
+    mtimer_start(100);
+    host_mtime_advance(50);
+    host_poll();
+    CHECK(fired == 0);
+
+    host_mtime_advance(60);
+    host_poll();
+    CHECK(fired == 1);
+
+    // wfi sleeps until the next deadline
+    mtimer_start(1000);
+    host_wfi();
+    CHECK(fired == 2);
+}
+
+static void test_ring() {
+    uint32_t buf[4];
+    spsc_t r;
+    uint32_t v;
+
+    spsc_init(&r, buf, 4);
+    for (uint32_t i = 0; i < 4; i++) {
+        CHECK(spsc_push(&r, i));
+    }
+    CHECK(!spsc_push(&r, 4));
+    CHECK(spsc_pop(&r, &v) && v == 0);
+    CHECK(spsc_count(&r) == 3);
+}
+
+// Pushes ITEMS words tagged with the producer's id in the top byte
+static void *_mpsc_producer(void *arg) {
+    uint32_t id = (uint32_t)(uintptr_t)arg;
+
+    for (uint32_t i = 0; i < ITEMS; i++) {
+        while (!mpsc_push(&mpsc, id << 24 | i)) {
+            sched_yield();
+        }
+    }
+    return 0;
+}
+
+static void test_mpsc_threads() {
+    static mpsc_cell_t cells[RING_SIZE];
+    pthread_t t[PRODUCERS];
+    uint32_t next[PRODUCERS] = {0};
+    uint32_t order = 1;
+    uint32_t v;
+
+    mpsc_init(&mpsc, cells, RING_SIZE);
+    for (uint32_t i = 0; i < PRODUCERS; i++) {
+        pthread_create(&t[i], 0, _mpsc_producer, (void *)(uintptr_t)i);
+    }
+    // each producer's words arrive in the order pushed, none lost
+    for (uint32_t n = 0; n < PRODUCERS * ITEMS; n++) {
+        while (!mpsc_pop(&mpsc, &v)) {
+            sched_yield();
+        }
+        if (v >> 24 >= PRODUCERS || (v & 0xffffff) != next[v >> 24]++) {
+            order = 0;
+        }
+    }
+    for (uint32_t i = 0; i < PRODUCERS; i++) {
+        pthread_join(t[i], 0);
+        CHECK(next[i] == ITEMS);
+    }
+    CHECK(order);
+    CHECK(!mpsc_pop(&mpsc, &v));
+}
+
+static void *_spsc_producer(void *arg) {
+    (void)arg;
+    for (uint32_t i = 0; i < ITEMS; i++) {
+        while (!spsc_push(&spsc, i)) {
+            sched_yield();
+        }
+    }
+    return 0;
+}
+
+// Counts the words that arrived out of order, draining all of them so the
+// producer never stalls on a full ring
+static void *_spsc_consumer(void *arg) {
+    uint32_t *bad = arg;
+    uint32_t v;
+
+    for (uint32_t i = 0; i < ITEMS; i++) {
+        while (!spsc_pop(&spsc, &v)) {
+            sched_yield();
+        }
+        if (v != i) {
+            (*bad)++;
+        }
+    }
+    return 0;
+}
+
+static void test_spsc_threads() {
+    static uint32_t buf[RING_SIZE];
+    pthread_t prod, cons;
+    uint32_t bad = 0;
+
+    spsc_init(&spsc, buf, RING_SIZE);
+    pthread_create(&cons, 0, _spsc_consumer, &bad);
+    pthread_create(&prod, 0, _spsc_producer, 0);
+    pthread_join(prod, 0);
+    pthread_join(cons, 0);
+    CHECK(bad == 0);
+    CHECK(spsc_count(&spsc) == 0);
+}
+
+// Publishes ITEMS snapshots with every word set to the same value
+static void *_seqlock_writer(void *arg) {
+    (void)arg;
+    for (uint32_t i = 1; i <= ITEMS; i++) {
+        seqlock_write_begin(&snap_lock);
+        for (uint32_t w = 0; w < 4; w++) {
+            snap[w] = i;
+            // let readers in halfway, as an interrupt or the other core would
+            if (w == 1) {
+                sched_yield();
+            }
+        }
+        seqlock_write_end(&snap_lock);
+    }
+    __atomic_store_n(&snap_done, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+// Counts torn snapshots, and snapshots that went back in time
+static void *_seqlock_reader(void *arg) {
+    uint32_t *bad = arg;
+    uint32_t copy[4];
+    uint32_t last = 0;
+    uint32_t seq;
+
+    while (!__atomic_load_n(&snap_done, __ATOMIC_ACQUIRE)) {
+        for (;;) {
+            seq = seqlock_read_begin(&snap_lock);
+            for (uint32_t w = 0; w < 4; w++) {
+                copy[w] = snap[w];
+            }
+            if (!seqlock_read_retry(&snap_lock, seq)) {
+                break;
+            }
+            sched_yield();
+        }
+        if (copy[0] != copy[1] || copy[0] != copy[2] || copy[0] != copy[3] ||
+            copy[0] < last) {
+            (*bad)++;
+        }
+        last = copy[0];
+    }
+    return 0;
+}
+
+static void test_seqlock_threads() {
+    pthread_t writer, readers[READERS];
+    uint32_t bad[READERS] = {0};
+
+    seqlock_init(&snap_lock);
+    memset((void *)snap, 0, sizeof(snap));
+    snap_done = 0;
+    for (uint32_t i = 0; i < READERS; i++) {
+        pthread_create(&readers[i], 0, _seqlock_reader, &bad[i]);
+    }
+    pthread_create(&writer, 0, _seqlock_writer, 0);
+    pthread_join(writer, 0);
+    for (uint32_t i = 0; i < READERS; i++) {
+        pthread_join(readers[i], 0);
+        CHECK(bad[i] == 0);
+    }
+    CHECK(seqlock_read_begin(&snap_lock) == 2 * ITEMS);
+}
+
+static void test_pool() {
+    obj_t *o[POOL_N];
+    pool_stats_t st;
+
+    for (uint32_t round = 0; round < 2; round++) {
+        for (uint32_t i = 0; i < POOL_N; i++) {
+            o[i] = POOL_NEW(obj_pool, obj_t);
+            CHECK(o[i] && !((uintptr_t)o[i] & 7));
+            if (o[i]) {
+                o[i]->id = i;
+            }
+        }
+        CHECK(!pool_alloc(&obj_pool));
+        // no block was handed out twice
+        for (uint32_t i = 0; i < POOL_N; i++) {
+            CHECK(o[i] && o[i]->id == i);
+        }
+        // the second round is served from the cache and the shared list
+        for (uint32_t i = 0; i < POOL_N; i++) {
+            pool_free(&obj_pool, o[i]);
+        }
+    }
+
+    pool_stats(&obj_pool, &st);
+    CHECK(st.size == 16);
+    CHECK(st.in_use == 0);
+    CHECK(st.high_water == POOL_N);
+    CHECK(st.allocs == 2 * POOL_N);
+    CHECK(st.failures == 2);
+
+    pool_free(&obj_pool, 0);
+    pool_free(&obj_pool, (char *)o[0] + 4);
+    CHECK(host_breakpoints() == 1);
+
+    // caches hold at most half of a pool, and none of a tiny one, whose
+    // freed blocks go straight back to the shared list for either core
+    CHECK(obj_pool.cache_size == 4);
+    CHECK(tiny_pool.cache_size == 0);
+    for (uint32_t i = 0; i < TINY_N; i++) {
+        o[i] = POOL_NEW(tiny_pool, obj_t);
+        CHECK(o[i]);
+    }
+    CHECK(!pool_alloc(&tiny_pool));
+    pool_free(&tiny_pool, o[1]);
+    CHECK(!tiny_pool.cpu[0].count && atomic_u32_load(&tiny_pool.head));
+    CHECK(POOL_NEW(tiny_pool, obj_t) == o[1]);
+}
+
+static void test_tlsf() {
+    static uint8_t *live[HEAP_LIVE];
+    static uint32_t len[HEAP_LIVE];
+    tlsf_stats_t st;
+    uint8_t *a;
+    uint8_t *b;
+    uint8_t *c;
+    uint32_t k;
+
+    tlsf_init(&heap, heap_mem, sizeof(heap_mem));
+    tlsf_stats(&heap, &st);
+    CHECK(st.size == HEAP_SIZE);
+    CHECK(st.free_blocks == 1 && st.free == HEAP_SIZE - 2 * TLSF_OVERHEAD);
+
+    // split from the front, then merged back whatever the order of frees
+    a = tlsf_alloc(&heap, 10);
+    b = tlsf_alloc(&heap, 100);
+    c = tlsf_alloc(&heap, 1000);
+    CHECK(a && b && c);
+    CHECK(b == a + 16 + TLSF_OVERHEAD && c == b + 104 + TLSF_OVERHEAD);
+    CHECK(!((uintptr_t)a & 7) && !((uintptr_t)b & 7) && !((uintptr_t)c & 7));
+    tlsf_free(&heap, a);
+    tlsf_free(&heap, c);
+    tlsf_free(&heap, b);
+    tlsf_stats(&heap, &st);
+    CHECK(st.free_blocks == 1 && st.free == HEAP_SIZE - 2 * TLSF_OVERHEAD);
+    CHECK(!st.used && st.high_water == 16 + 104 + 1000 + 3 * TLSF_OVERHEAD);
+
+    CHECK(!tlsf_alloc(&heap, HEAP_SIZE));
+    CHECK(!tlsf_alloc(&heap, MAX_UINT32));
+
+    // random sizes, every block keeps its contents until freed
+    for (uint32_t i = 0; i < 20000; i++) {
+        k = _rand() % HEAP_LIVE;
+        if (live[k]) {
+            for (uint32_t j = 0; j < len[k]; j++) {
+                CHECK(live[k][j] == (uint8_t)(k ^ j));
+            }
+            tlsf_free(&heap, live[k]);
+        }
+        len[k] = _rand() % 300 + 1;
+        live[k] = tlsf_alloc(&heap, len[k]);
+        for (uint32_t j = 0; live[k] && j < len[k]; j++) {
+            live[k][j] = k ^ j;
+        }
+    }
+    for (k = 0; k < HEAP_LIVE; k++) {
+        tlsf_free(&heap, live[k]);
+    }
+    tlsf_stats(&heap, &st);
+    CHECK(st.free_blocks == 1 && st.free == HEAP_SIZE - 2 * TLSF_OVERHEAD);
+    CHECK(!st.used && st.allocs == st.frees);
+    CHECK(st.failures > 2);
+
+    // double free, and a pointer outside the heap
+    a = tlsf_alloc(&heap, 8);
+    tlsf_free(&heap, a);
+    tlsf_free(&heap, a);
+    tlsf_free(&heap, (uint8_t *)heap_mem + HEAP_SIZE);
+    CHECK(host_breakpoints() == 2);
+}
+
+void isr_mtimer_irq() {
+    fired++;
+}
+
+static double _now_ns() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void _bench(const char *name, void (*fn)()) {
+    double start;
+
+    fn();
+    start = _now_ns();
+    for (uint32_t i = 0; i < BENCH_ITERS; i++) {
+        fn();
+    }
+    printf("bench %-16s %8.1f ns/call\n", name,
+           (_now_ns() - start) / BENCH_ITERS);
+}
+
+static void bench_mtime_read() {
+    (void)mtime_read();
+}
+
+static void bench_us_to_cycles() {
+    static volatile uint64_t us = 123456;
+    (void)us_to_cycles(us);
+}
+
+static void bench_uart_putc() {
+    static char buf[256];
+
+    uart_putc('x');
+    host_uart_tx(buf, sizeof(buf));
+}
+
+static void bench_fifo_round_trip() {
+    uint32_t v;
+
+    multicore_fifo_push_blocking(1);
+    host_fifo_pop(&v);
+    host_fifo_push(v);
+    (void)multicore_fifo_pop_blocking();
+}
+
+static void bench_pool_alloc_free() {
+    pool_free(&obj_pool, pool_alloc(&obj_pool));
+}
+
+static void bench_tlsf_alloc_free() {
+    tlsf_free(&heap, tlsf_alloc(&heap, 64));
+}
+
+static void bench_timer_start_cancel() {
+    static ktimer_t t;
+
+    timer_start(&t, mtime_read() + 1000, 0, 0);
+    timer_cancel(&t);
+}
+
+int main() {
+    static const struct {
+        const char *name;
+        void (*fn)();
+    } tests[] = {
+        {"resets", test_resets}, {"clocks", test_clocks},
+        {"uart_polled", test_uart_polled}, {"uart_irq", test_uart_irq},
+        {"fifo", test_fifo},     {"mtimer", test_mtimer},
+        {"ring", test_ring},     {"mpsc_threads", test_mpsc_threads},
+        {"spsc_threads", test_spsc_threads},
+        {"seqlock_threads", test_seqlock_threads},
+        {"pool", test_pool},     {"tlsf", test_tlsf},
+    };
+
+    for (uint32_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+        uint32_t before = failures;
+
+        host_reset();
+        fired = 0;
+        tests[i].fn();
+        printf("%s %s\n", failures == before ? "ok  " : "FAIL",
+               tests[i].name);
+    }
+
+    host_reset();
+    timer_init();
+    _bench("mtime_read", bench_mtime_read);
+    _bench("us_to_cycles", bench_us_to_cycles);
+    _bench("uart_putc", bench_uart_putc);
+    _bench("fifo_round_trip", bench_fifo_round_trip);
+    _bench("timer_start", bench_timer_start_cancel);
+    _bench("pool_alloc_free", bench_pool_alloc_free);
+    _bench("tlsf_alloc_free", bench_tlsf_alloc_free);
+
+    return failures ? 1 : 0;
+}
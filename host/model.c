@@ -0,0 +1,521 @@
+/**
+ * @file model.c
+ * @brief Implements the emulated register model.
+ *
+ * host_reg hands out a pointer for each access. For plain registers it is
+ * the register's storage, so reads and writes just work. Registers with
+ * side effects get a scratch word instead, and the access is resolved at
+ * the start of the next host_* call: alias and write-only registers apply
+ * whatever was left in the scratch word, and registers that can be both
+ * read and written are filled with HOST_READ_MARK set, which no write from
+ * the drivers has, so a changed word means a write.
+ *
+ * @author Herbie Rand
+ */
+
+#include "host.h"
+#include "asm.h"
+#include "fifo.h"
+#include "resets.h"
+#include "rp2350.h"
+#include "timer.h"
+#include "types.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REGS 1024
+
+/** @brief Set in a read-fill, never set by a write, see above */
+#define HOST_READ_MARK 0x80000000
+
+#define UART_RX_SIZE 256
+
+#define PLL_PWR_RESET 0x2d
+#define PLL_PWR_ON    ((1 << 5) | 1)
+
+void isr_irq33();
+
+typedef enum {
+    PLAIN,
+    ALIAS,
+    WRITE_ONLY,
+    MIXED,
+} kind_t;
+
+static struct {
+    uint32_t addr;
+    uint32_t val;
+    uint32_t used;
+} regs[REGS];
+
+/** @brief The access handed out last, resolved by _commit */
+static struct {
+    uint32_t addr;
+    kind_t kind;
+    uint32_t fill;
+    uint32_t scratch;
+} last;
+
+static struct {
+    uint32_t mstatus;
+    uint32_t mie;
+    uint32_t mip;
+    uint32_t mcountinhibit;
+    uint32_t mcounteren;
+    uint32_t mscratch;
+    uint32_t mepc;
+    uint32_t mcause;
+    uint64_t mcycle;
+    uint64_t minstret;
+    /** @brief MEIEA of core 0, one bit per IRQ */
+    uint64_t meiea;
+} csr;
+
+static uint64_t mtime;
+
+static struct {
+    char buf[UART_RX_SIZE];
+    uint32_t head;
+    uint32_t tail;
+} rx;
+
+static struct {
+    char *buf;
+    uint32_t len;
+    uint32_t cap;
+} tx;
+
+/** @brief Inter-core FIFOs, [0] into this core and [1] out of it */
+static struct {
+    uint32_t buf[HOST_FIFO_DEPTH];
+    uint32_t head;
+    uint32_t tail;
+} fifo[2];
+static uint32_t fifo_flags;
+
+static uint32_t breakpoints;
+static uint32_t polling;
+
+static void _commit();
+static uint32_t *_reg(uint32_t addr);
+static uint32_t _reset_value(uint32_t addr);
+static uint32_t _read(uint32_t addr, kind_t *kind);
+static void _write(uint32_t addr, uint32_t val);
+static uint32_t _uart_ris();
+static uint32_t _clocks_selected(uint32_t addr);
+static uint32_t _fifo_count(uint32_t i);
+static uint64_t *_csr64(const char *name, uint32_t *hi);
+static uint32_t *_csr32(const char *name);
+
+volatile uint32_t *host_reg(uint32_t addr) {
+    kind_t kind = PLAIN;
+    uint32_t v;
+
+    _commit();
+
+    // atomic XOR/SET/CLR aliases of the APB and AHB peripherals
+    if (addr >= 0x40000000 && addr < 0x60000000 && (addr & 0x3000)) {
+        last.addr = addr;
+        last.kind = ALIAS;
+        last.scratch = 0;
+        return &last.scratch;
+    }
+
+    v = _read(addr, &kind);
+    last.addr = addr;
+    last.kind = kind;
+    if (kind == PLAIN) {
+        *_reg(addr) = v;
+        return _reg(addr);
+    }
+    last.fill = kind == MIXED ? v | HOST_READ_MARK : v;
+    last.scratch = last.fill;
+    return &last.scratch;
+}
+
+uint32_t host_csr_read(const char *name) {
+    uint32_t hi;
+    uint64_t *c64 = _csr64(name, &hi);
+    uint32_t v;
+
+    _commit();
+    if (c64) {
+        // advance on every read, so busy waits on the counter end
+        if (!hi && !(csr.mcountinhibit & 0x1)) {
+            (*c64)++;
+        }
+        return hi ? (uint32_t)(*c64 >> 32) : (uint32_t)*c64;
+    }
+    if (!strcmp(name, "mhartid")) {
+        return 0;
+    }
+    v = *_csr32(name);
+    if (!strcmp(name, "mip")) {
+        v |= (mtime >= (((uint64_t)*_reg(SIO_MTIMECMPH) << 32) |
+                        *_reg(SIO_MTIMECMP)))
+                 ? MTI_MASK
+                 : 0;
+        v |= (csr.meiea & (1ULL << UART0_IRQ)) && (_uart_ris() &
+                                                   *_reg(UART0_UARTIMSC))
+                 ? MEI_MASK
+                 : 0;
+    }
+    return v;
+}
+
+void host_csr_write(const char *name, uint32_t val) {
+    uint32_t hi;
+    uint64_t *c64 = _csr64(name, &hi);
+
+    _commit();
+    if (c64) {
+        *c64 = hi ? (*c64 & 0xffffffff) | ((uint64_t)val << 32)
+                  : (*c64 & ~0xffffffffULL) | val;
+        return;
+    }
+    *_csr32(name) = val;
+    // e.g. irq_restore, interrupts that were held off are taken now
+    host_poll();
+}
+
+void host_reset() {
+    memset(regs, 0, sizeof(regs));
+    memset(&last, 0, sizeof(last));
+    memset(&csr, 0, sizeof(csr));
+    memset(&rx, 0, sizeof(rx));
+    memset(fifo, 0, sizeof(fifo));
+    tx.len = 0;
+    mtime = 0;
+    fifo_flags = 0;
+    breakpoints = 0;
+    // MTIMECMP resets to all ones in startup.S
+    *_reg(SIO_MTIMECMP) = MAX_UINT32;
+    *_reg(SIO_MTIMECMPH) = MAX_UINT32;
+}
+
+void host_poll() {
+    uint32_t mstatus;
+    uint32_t mip;
+
+    _commit();
+    if (polling || !(csr.mstatus & MIE_MASK)) {
+        return;
+    }
+    polling = 1;
+    for (;;) {
+        mip = host_csr_read("mip") & csr.mie;
+        if (!mip) {
+            break;
+        }
+        // as on trap entry, no nesting
+        mstatus = csr.mstatus;
+        csr.mstatus &= ~MIE_MASK;
+        if (mip & MTI_MASK) {
+            timer_irq();
+        } else {
+            isr_irq33();
+        }
+        _commit();
+        csr.mstatus = mstatus;
+    }
+    polling = 0;
+}
+
+void host_wfi() {
+    uint64_t cmp;
+
+    _commit();
+    cmp = ((uint64_t)*_reg(SIO_MTIMECMPH) << 32) | *_reg(SIO_MTIMECMP);
+    if ((csr.mie & MTI_MASK) && cmp != MAX_UINT64 && mtime < cmp) {
+        mtime = cmp;
+    }
+    host_poll();
+}
+
+void host_mtime_advance(uint64_t ticks) {
+    _commit();
+    mtime += ticks;
+}
+
+void host_uart_rx(const char *buf, uint32_t n) {
+    _commit();
+    while (n-- && rx.head - rx.tail < UART_RX_SIZE) {
+        rx.buf[rx.head++ % UART_RX_SIZE] = *buf++;
+    }
+}
+
+uint32_t host_uart_tx(char *buf, uint32_t n) {
+    _commit();
+    if (n > tx.len) {
+        n = tx.len;
+    }
+    memcpy(buf, tx.buf, n);
+    memmove(tx.buf, tx.buf + n, tx.len - n);
+    tx.len -= n;
+    return n;
+}
+
+uint32_t host_fifo_push(uint32_t v) {
+    _commit();
+    if (_fifo_count(0) == HOST_FIFO_DEPTH) {
+        return 0;
+    }
+    fifo[0].buf[fifo[0].head++ % HOST_FIFO_DEPTH] = v;
+    return 1;
+}
+
+uint32_t host_fifo_pop(uint32_t *v) {
+    _commit();
+    if (!_fifo_count(1)) {
+        return 0;
+    }
+    *v = fifo[1].buf[fifo[1].tail++ % HOST_FIFO_DEPTH];
+    return 1;
+}
+
+uint32_t host_breakpoints() {
+    return breakpoints;
+}
+
+void breakpoint() {
+    // like continuing from the debugger
+    breakpoints++;
+}
+
+void irq_enable(uint32_t irq) {
+    _commit();
+    csr.meiea |= 1ULL << irq;
+    host_poll();
+}
+
+void irq_disable(uint32_t irq) {
+    _commit();
+    csr.meiea &= ~(1ULL << irq);
+}
+
+void set_mie(uint32_t mask) {
+    host_csr_write("mie", csr.mie | mask);
+}
+
+void set_mstatus(uint32_t mask) {
+    host_csr_write("mstatus", csr.mstatus | mask);
+}
+
+void clr_mip(uint32_t mask) {
+    host_csr_write("mip", csr.mip & ~mask);
+}
+
+void clr_mstatus(uint32_t mask) {
+    host_csr_write("mstatus", csr.mstatus & ~mask);
+}
+
+// Resolves the access handed out by host_reg last, see the top of the file
+static void _commit() {
+    kind_t kind = last.kind;
+    uint32_t v = last.scratch;
+    uint32_t base;
+
+    last.kind = PLAIN;
+    switch (kind) {
+    case PLAIN:
+        return;
+    case ALIAS:
+        base = last.addr & ~0x3000;
+        switch (last.addr & 0x3000) {
+        case ATOMIC_XOR_OFFSET:
+            _write(base, *_reg(base) ^ v);
+            break;
+        case ATOMIC_BITSET_OFFSET:
+            _write(base, *_reg(base) | v);
+            break;
+        default:
+            _write(base, *_reg(base) & ~v);
+            break;
+        }
+        return;
+    case WRITE_ONLY:
+        _write(last.addr, v);
+        return;
+    case MIXED:
+        if (v != last.fill) {
+            _write(last.addr, v);
+        } else if (last.addr == UART0_UARTDR && rx.head != rx.tail) {
+            // a read, which pops the RX FIFO
+            rx.tail++;
+        }
+        return;
+    }
+}
+
+static uint32_t *_reg(uint32_t addr) {
+    uint32_t i = (addr >> 2) % REGS;
+
+    while (regs[i].used && regs[i].addr != addr) {
+        i = (i + 1) % REGS;
+    }
+    if (!regs[i].used) {
+        regs[i].used = 1;
+        regs[i].addr = addr;
+        regs[i].val = _reset_value(addr);
+    }
+    return &regs[i].val;
+}
+
+static uint32_t _reset_value(uint32_t addr) {
+    switch (addr) {
+    case RESETS_RESET:
+        return RESET_BITS;
+    case PLL_SYS_PWR:
+    case PLL_USB_PWR:
+        return PLL_PWR_RESET;
+    }
+    return 0;
+}
+
+// Returns the value a read of addr sees, and how the access is resolved
+static uint32_t _read(uint32_t addr, kind_t *kind) {
+    uint32_t v = *_reg(addr);
+
+    switch (addr) {
+    case RESETS_RESET:
+        // bits above the last block are reserved
+        return v & RESET_BITS;
+    case RESETS_RESET_DONE:
+        return ~*_reg(RESETS_RESET) & RESET_BITS;
+    case XOSC_STATUS:
+        return (*_reg(XOSC_CTRL) & XOSC_CTRL_ENABLE_BITS) ==
+                       XOSC_CTRL_ENABLE_VALUE
+                   ? XOSC_STATUS_STABLE
+                   : 0;
+    case PLL_SYS_CS:
+        return (v & ~PLL_CS_LOCK_MASK) |
+               ((*_reg(PLL_SYS_PWR) & PLL_PWR_ON) ? 0 : PLL_CS_LOCK_MASK);
+    case PLL_USB_CS:
+        return (v & ~PLL_CS_LOCK_MASK) |
+               ((*_reg(PLL_USB_PWR) & PLL_PWR_ON) ? 0 : PLL_CS_LOCK_MASK);
+    case UART0_UARTDR:
+        *kind = MIXED;
+        return rx.head != rx.tail ? (uint8_t)rx.buf[rx.tail % UART_RX_SIZE]
+                                  : 0;
+    case UART0_UARTFR:
+        // TX drains instantly, so it is never full nor busy
+        return UARTFR_TXFE | (rx.head == rx.tail ? UARTFR_RXFE : 0) |
+               (rx.head - rx.tail >= 32 ? UARTFR_RXFF : 0);
+    case UART0_UARTRIS:
+        return _uart_ris();
+    case UART0_UARTMIS:
+        return _uart_ris() & *_reg(UART0_UARTIMSC);
+    case UART0_UARTICR:
+        *kind = WRITE_ONLY;
+        return 0;
+    case SIO_FIFO_ST:
+        *kind = MIXED;
+        return fifo_flags | (_fifo_count(0) ? ST_VLD : 0) |
+               (_fifo_count(1) < HOST_FIFO_DEPTH ? ST_RDY : 0);
+    case SIO_FIFO_WR:
+        *kind = WRITE_ONLY;
+        return 0;
+    case SIO_FIFO_RD:
+        if (!_fifo_count(0)) {
+            fifo_flags |= ST_ROE;
+            return 0;
+        }
+        return fifo[0].buf[fifo[0].tail++ % HOST_FIFO_DEPTH];
+    case SIO_MTIME:
+        return (uint32_t)++mtime;
+    case SIO_MTIMEH:
+        return (uint32_t)(mtime >> 32);
+    }
+    if (addr >= CLOCKS_BASE && addr < CLOCKS_BASE + 0x78 &&
+        (addr - CLOCKS_BASE) % 12 == 8) {
+        return _clocks_selected(addr);
+    }
+    return v;
+}
+
+// Applies a write that has side effects
+static void _write(uint32_t addr, uint32_t val) {
+    switch (addr) {
+    case UART0_UARTDR:
+        if (tx.len == tx.cap) {
+            tx.cap = tx.cap ? 2 * tx.cap : 256;
+            tx.buf = realloc(tx.buf, tx.cap);
+        }
+        tx.buf[tx.len++] = (char)val;
+        return;
+    case UART0_UARTICR:
+        // RIS is level-triggered from the FIFO state, nothing to clear
+        return;
+    case SIO_FIFO_ST:
+        fifo_flags &= ~(val & (ST_WOF | ST_ROE));
+        return;
+    case SIO_FIFO_WR:
+        if (_fifo_count(1) == HOST_FIFO_DEPTH) {
+            fifo_flags |= ST_WOF;
+            return;
+        }
+        fifo[1].buf[fifo[1].head++ % HOST_FIFO_DEPTH] = val;
+        return;
+    }
+    *_reg(addr) = val;
+}
+
+static uint32_t _uart_ris() {
+    // TX FIFO is always empty, so below any trigger level
+    return UARTINT_TX | (rx.head != rx.tail ? UARTINT_RX | UARTINT_RT : 0);
+}
+
+static uint32_t _clocks_selected(uint32_t addr) {
+    uint32_t ctrl = *_reg(addr - 8);
+
+    if (addr == CLOCKS_CLK_REF_SELECTED) {
+        return 1 << (ctrl & 0x3);
+    }
+    if (addr == CLOCKS_CLK_SYS_SELECTED) {
+        return 1 << (ctrl & 0x1);
+    }
+    return 1;
+}
+
+static uint32_t _fifo_count(uint32_t i) {
+    return fifo[i].head - fifo[i].tail;
+}
+
+static uint64_t *_csr64(const char *name, uint32_t *hi) {
+    uint32_t n = strlen(name);
+
+    *hi = n && name[n - 1] == 'h';
+    if (!strncmp(name, "mcycle", 6) || !strncmp(name, "cycle", 5)) {
+        return &csr.mcycle;
+    }
+    if (!strncmp(name, "minstret", 8) || !strncmp(name, "instret", 7)) {
+        return &csr.minstret;
+    }
+    return 0;
+}
+
+static uint32_t *_csr32(const char *name) {
+    static const struct {
+        const char *name;
+        uint32_t *v;
+    } map[] = {
+        {"mstatus", &csr.mstatus},
+        {"mie", &csr.mie},
+        {"mip", &csr.mip},
+        {"mcountinhibit", &csr.mcountinhibit},
+        {"mcounteren", &csr.mcounteren},
+        {"mscratch", &csr.mscratch},
+        {"mepc", &csr.mepc},
+        {"mcause", &csr.mcause},
+    };
+
+    for (uint32_t i = 0; i < sizeof(map) / sizeof(map[0]); i++) {
+        if (!strcmp(name, map[i].name)) {
+            return map[i].v;
+        }
+    }
+    fprintf(stderr, "host: CSR %s is not modelled\n", name);
+    abort();
+}
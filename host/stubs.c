@@ -0,0 +1,71 @@
+/**
+ * @file stubs.c
+ * @brief Host stand-ins for the parts of the kernel that only make sense on
+ *        the target: asm.S helpers, per-core state and DMA.
+ * @author Herbie Rand
+ */
+
+#include "asm.h"
+#include "dma.h"
+#include "host.h"
+#include "runtime.h"
+#include "types.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+cpu_t cpus[NUM_CORES] = {{0, 0, 1, 0}, {0, 1, 0, 0}};
+
+void cpu_init() {
+}
+
+void launch_core1(void (*entry)()) {
+    (void)entry;
+    fprintf(stderr, "host: core 1 is not modelled\n");
+    abort();
+}
+
+void inc_mepc() {
+    host_csr_write("mepc", host_csr_read("mepc") + 4);
+}
+
+void clr_meifa() {
+}
+
+void irq_force(uint32_t irq) {
+    (void)irq;
+}
+
+void irq_unforce(uint32_t irq) {
+    (void)irq;
+}
+
+void sev() {
+}
+
+void pmp_user_init() {
+}
+
+/**
+ * @brief Default isr_mtimer_irq, like the weak definition in startup.S.
+ */
+__attribute__((weak)) void isr_mtimer_irq() {
+    breakpoint();
+}
+
+// No DMA channels on the host, callers see them all busy
+
+int32_t dma_to_periph(uint32_t reg, const void *src, uint32_t n,
+                      uint32_t size, uint32_t dreq, void (*done)(void *),
+                      void *arg) {
+    (void)reg, (void)src, (void)n, (void)size, (void)dreq, (void)done;
+    (void)arg;
+    return -1;
+}
+
+int32_t dma_from_periph(void *dst, uint32_t reg, uint32_t n, uint32_t size,
+                        uint32_t dreq, void (*done)(void *), void *arg) {
+    (void)dst, (void)reg, (void)n, (void)size, (void)dreq, (void)done;
+    (void)arg;
+    return -1;
+}
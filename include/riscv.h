@@ -1,4 +1,52 @@
+/**
+ * @file riscv.h
+ * @brief CSR accessors, usable from both kernel and user code.
+ * @author Herbie Rand
+ */
+
 #ifndef RISCV_H
 #define RISCV_H
 
+#include "types.h"
+
+#ifdef HOST
+// CSRs of the emulated core, see host/host.h
+#include "host.h"
+
+#define csr_read(csr)       host_csr_read(#csr)
+#define csr_write(csr, val) host_csr_write(#csr, (val))
+#define csr_set(csr, mask)  host_csr_write(#csr, host_csr_read(#csr) | (mask))
+#define csr_clear(csr, mask)                                                   \
+    host_csr_write(#csr, host_csr_read(#csr) & ~(mask))
+#else
+
+/**
+ * @brief Reads a CSR by name or number.
+ * @param csr   CSR name (e.g. mcycle) or number (e.g. 0xbe5)
+ * @returns Integer CSR value
+ */
+#define csr_read(csr)                                                          \
+    ({                                                                         \
+        uint32_t __v;                                                          \
+        asm volatile("csrr %0, " #csr : "=r"(__v));                            \
+        __v;                                                                   \
+    })
+
+/**
+ * @brief Writes a value to a CSR.
+ */
+#define csr_write(csr, val) asm volatile("csrw " #csr ", %0" : : "r"(val))
+
+/**
+ * @brief Sets bits in a CSR.
+ */
+#define csr_set(csr, mask) asm volatile("csrs " #csr ", %0" : : "r"(mask))
+
+/**
+ * @brief Clears bits in a CSR.
+ */
+#define csr_clear(csr, mask) asm volatile("csrc " #csr ", %0" : : "r"(mask))
+
+#endif
+
 #endif
@@ -6,10 +6,19 @@
 #ifndef SYS_H
 #define SYS_H
 
-#define SYSCALL_COUNT 3
+#define SYSCALL_COUNT 12
 
-#define SYS_LED_ON  0
-#define SYS_LED_OFF 1
-#define SYS_SPIN_MS 2
+#define SYS_LED_ON         0
+#define SYS_LED_OFF        1
+#define SYS_SPIN_MS        2
+#define SYS_TASK_CREATE    3
+#define SYS_TASK_YIELD     4
+#define SYS_TASK_EXIT      5
+#define SYS_NULL           6
+#define SYS_USER_RETURN    7
+#define SYS_URING_SETUP    8
+#define SYS_URING_ENTER    9
+#define SYS_SLEEP_US       10
+#define SYS_URING_TEARDOWN 11
 
 #endif
@@ -0,0 +1,38 @@
+/**
+ * @file timebase.h
+ * @brief The mtime counter, as both kernel and user code see it.
+ *
+ * pmp_user_init lets U-mode read the two mtime words, and nothing else of
+ * their peripheral, so user code reads the time without a trap, see
+ * now_us in user/time.h.
+ *
+ * @author Herbie Rand
+ */
+
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+/**
+ * @brief mtime ticks per microsecond.
+ *
+ * mtime is clocked by the RISC-V tick generator, which divides clk_ref down
+ * to this rate. `mtime_calibrate` keeps the divider in step with clk_ref, so
+ * the rate (and every armed deadline) survives clock reconfiguration.
+ * Must divide clk_ref in MHz, and be a power of two. On the virt machine,
+ * mtime is the CLINT's, with a fixed 10 MHz timebase.
+ */
+#ifdef BOARD_QEMU_VIRT
+#define MTIME_TICKS_PER_US 10
+#else
+#define MTIME_TICKS_PER_US 1
+#endif
+
+/** @brief Low word of mtime, the high word follows. SIO_MTIME in rp2350.h */
+#ifdef BOARD_QEMU_VIRT
+#define TIMEBASE_MTIME 0x0200bff8
+#else
+#define TIMEBASE_MTIME 0xd00001b0
+#endif
+#define TIMEBASE_MTIMEH (TIMEBASE_MTIME + 4)
+
+#endif
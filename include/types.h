@@ -2,13 +2,21 @@
 #define TYPES_H
 
 #define MAX_UINT32 0xffffffff
+#define MAX_UINT64 0xffffffffffffffffULL
 
+// host builds (make host) take the C library's, long is 64-bit there
+#ifdef HOST
+#include <stdint.h>
+#else
 typedef unsigned char uint8_t;
 typedef unsigned short uint16_t;
 typedef unsigned long uint32_t;
+typedef unsigned long long uint64_t;
 
 typedef signed char int8_t;
 typedef signed short int16_t;
 typedef signed long int32_t;
+typedef signed long long int64_t;
+#endif
 
 #endif
@@ -0,0 +1,55 @@
+/**
+ * @file uring.h
+ * @brief Layout of the batched syscall rings, shared by kernel and user
+ *        code.
+ *
+ * U-mode queues syscalls as submission entries (SQEs) and the kernel
+ * answers each with a completion entry (CQE), so that a whole batch costs
+ * one ecall, or none when the kernel polls the ring. Both rings live in one
+ * uring_t, one of URING_MAX that the kernel hands out at the front of the
+ * user heap's region, which U-mode may access through PMP.
+ *
+ * Each index only ever grows and is written by one side: U-mode owns
+ * sq_tail and cq_head, the kernel owns sq_head and cq_tail. An SQE is
+ * consumed only once there is room for its CQE, so the completion ring
+ * never overflows.
+ *
+ * @see user/batch.h for the U-mode side, kernel/uring.c for the kernel's
+ * @author Herbie Rand
+ */
+
+#ifndef URING_H
+#define URING_H
+
+#include "types.h"
+
+/** @brief Entries in each ring, a power of two */
+#define URING_ENTRIES 16
+/** @brief Rings set up at once, across all tasks */
+#define URING_MAX 4
+
+typedef struct {
+    /** @brief Syscall number, see sys.h */
+    uint32_t op;
+    uint32_t a0;
+    uint32_t a1;
+    /** @brief Copied into the CQE, to match it with its SQE */
+    uint32_t user_data;
+} uring_sqe_t;
+
+typedef struct {
+    uint32_t user_data;
+    /** @brief Value the syscall returned in a0, or -1 if op is refused */
+    int32_t res;
+} uring_cqe_t;
+
+typedef struct {
+    uint32_t sq_head;
+    uint32_t sq_tail;
+    uint32_t cq_head;
+    uint32_t cq_tail;
+    uring_sqe_t sq[URING_ENTRIES];
+    uring_cqe_t cq[URING_ENTRIES];
+} uring_t;
+
+#endif
@@ -1,19 +1,133 @@
 #ifndef ASM_H
 #define ASM_H
 
+#include "rp2350.h"
 #include "types.h"
 
+#ifdef HOST
+// registers of the emulated RP2350, see host/host.h
+#include "host.h"
+
+#define AT(addr) (*host_reg((uint32_t)(addr)))
+
+static __inline uint32_t irq_save() {
+    uint32_t mstatus = host_csr_read("mstatus");
+    host_csr_write("mstatus", mstatus & ~MIE_MASK);
+    return mstatus & MIE_MASK;
+}
+
+static __inline void irq_restore(uint32_t mie) {
+    host_csr_write("mstatus", host_csr_read("mstatus") | mie);
+}
+
+static __inline void wfi() {
+    host_wfi();
+}
+#else
+
 /**
  * @brief Access memory-mapped register value,
  *        may also be used for assignment
  */
 #define AT(addr) (*(volatile uint32_t *)(addr))
 
+/**
+ * @brief Disables machine interrupts.
+ * @returns Integer previous value of mstatus.MIE, for irq_restore
+ */
+static __inline uint32_t irq_save() {
+    uint32_t mstatus;
+    asm volatile("csrrci %0, mstatus, 0x8" : "=r"(mstatus) : : "memory");
+    return mstatus & MIE_MASK;
+}
+
+/**
+ * @brief Re-enables machine interrupts if they were enabled before irq_save.
+ * @param mie   Integer value returned by irq_save
+ */
+static __inline void irq_restore(uint32_t mie) {
+    asm volatile("csrs mstatus, %0" : : "r"(mie) : "memory");
+}
+
+/**
+ * @brief Waits for an interrupt, which wakes the core even while mstatus.MIE
+ *        is clear.
+ */
+static __inline void wfi() {
+    asm volatile("wfi");
+}
+
+#ifndef BOARD_QEMU_VIRT
+/**
+ * @brief Masks the external interrupts of priority ceiling and below, by
+ *        raising the preemption threshold in MEICONTEXT. Higher priorities,
+ *        and timer and software interrupts, are still taken, so only state
+ *        shared with handlers at or below the ceiling is protected.
+ * Never lowers the threshold, so sections nest, and a handler may enter
+ * one at or below its own priority. Under BOARD_QEMU_VIRT, this sets the
+ * PLIC threshold, whose coarser levels may mask the priority above too.
+ * @param ceiling   Integer priority, 0 to 15, see irq_set_priority
+ * @returns Integer previous threshold, for irq_ceiling_restore
+ */
+static __inline uint32_t irq_ceiling_save(uint32_t ceiling) {
+    uint32_t ctx;
+    uint32_t preempt = (ceiling + 1) << MEICONTEXT_PREEMPT_SHIFT;
+
+    // a handler taken in between leaves MEICONTEXT as it found it
+    asm volatile("csrr %0, 0xbe5" : "=r"(ctx) : : "memory");
+    if (preempt > (ctx & MEICONTEXT_PREEMPT_MASK)) {
+        asm volatile("csrw 0xbe5, %0"
+                     :
+                     : "r"((ctx & ~MEICONTEXT_PREEMPT_MASK) | preempt)
+                     : "memory");
+    }
+    return ctx & MEICONTEXT_PREEMPT_MASK;
+}
+
+/**
+ * @brief Puts back the threshold from before irq_ceiling_save.
+ * @param saved Integer value returned by irq_ceiling_save
+ */
+static __inline void irq_ceiling_restore(uint32_t saved) {
+    uint32_t ctx;
+
+    asm volatile("csrr %0, 0xbe5" : "=r"(ctx) : : "memory");
+    asm volatile("csrw 0xbe5, %0"
+                 :
+                 : "r"((ctx & ~MEICONTEXT_PREEMPT_MASK) | saved)
+                 : "memory");
+}
+#else
+static __inline uint32_t irq_ceiling_save(uint32_t ceiling) {
+    uint32_t old = AT(PLIC_HART_THRESHOLD);
+
+    // the PLIC masks priorities at or below its threshold
+    if (plic_priority(ceiling) > old) {
+        AT(PLIC_HART_THRESHOLD) = plic_priority(ceiling);
+    }
+    asm volatile("" : : : "memory");
+    return old;
+}
+
+static __inline void irq_ceiling_restore(uint32_t saved) {
+    asm volatile("" : : : "memory");
+    AT(PLIC_HART_THRESHOLD) = saved;
+}
+#endif
+#endif
+
 /**
  * @brief Triggers breakpoint (ebreak).
  */
 void breakpoint();
 
+/**
+ * @brief Stops a test whose check failed. A breakpoint under a debugger;
+ *        under QEMU, reports "@fail" and exits with a failing status, where
+ *        breakpoint() exits with 0.
+ */
+void test_fail();
+
 /**
  * @brief Increments mepc CSR.
  */
@@ -48,9 +162,67 @@ void clr_mstatus(uint32_t mask);
  */
 void clr_meifa();
 
+/**
+ * @brief Enables an external interrupt in this core's MEIEA.
+ * @param irq   Integer IRQ number
+ */
+void irq_enable(uint32_t irq);
+
+/**
+ * @brief Disables an external interrupt in this core's MEIEA.
+ * @param irq   Integer IRQ number
+ */
+void irq_disable(uint32_t irq);
+
+/**
+ * @brief Sets the priority of an external interrupt in this core's MEIPRA.
+ * Higher priorities preempt the handlers of lower ones. Under
+ * BOARD_QEMU_VIRT, the PLIC's fewer levels are shared by both cores.
+ * @param irq   Integer IRQ number
+ * @param prio  Integer priority, 0 (lowest, the default) to 15
+ */
+void irq_set_priority(uint32_t irq, uint32_t prio);
+
 /**
  * @brief Sends event to opposite core.
  */
 void sev();
 
+/**
+ * @brief Forces an IRQ pending through MEIFA, as if the peripheral raised it.
+ * @param irq   Integer IRQ number, 0 to 51
+ */
+void irq_force(uint32_t irq);
+
+/**
+ * @brief Clears an IRQ's force bit in MEIFA, leaving those of other IRQs.
+ * @param irq   Integer IRQ number, 0 to 51
+ */
+void irq_unforce(uint32_t irq);
+
+/**
+ * @brief Calls fn in U-mode on the given stack, and returns once it calls
+ *        `user_return` (SYS_USER_RETURN). PMP must already be set up.
+ * @param fn    U-mode function, must be in user text and must not return
+ * @param arg   Integer argument passed to fn in a0
+ * @param sp    Integer U-mode stack pointer
+ * @returns The two words passed to user_return, first one in the low half
+ */
+uint64_t user_call(void (*fn)(uint32_t), uint32_t arg, uint32_t sp);
+
+/**
+ * @brief Resumes the M-mode caller of `user_call`, returning a0 and a1.
+ * Only called by the SYS_USER_RETURN handler, from the syscall fast path.
+ * Lands in jail if no user_call is active on this core, so that U-mode code
+ * outside one, such as a task, cannot return into a stale M-mode stack.
+ */
+void user_call_return(uint32_t a0, uint32_t a1);
+
+/**
+ * @brief Configures PMP so that U-mode may execute user text and use the
+ *        calling core's user stack, the task stacks and the user heap, and
+ *        read mtime, see timebase.h. PMP is per core.
+ */
+void pmp_user_init();
+
 #endif
@@ -0,0 +1,92 @@
+/**
+ * @file atomic.h
+ * @brief Typed atomic wrappers over the A extension.
+ *
+ * Read-modify-write operations compile to single AMOs (or an lr/sc loop for
+ * compare-and-swap), so they are safe between tasks, ISRs and both cores
+ * without disabling interrupts. Loads acquire and stores release, every
+ * read-modify-write is sequentially consistent.
+ *
+ * NOTE: AMOs and lr/sc are only supported on SRAM, not on peripherals.
+ *
+ * @author Herbie Rand
+ */
+
+#ifndef ATOMIC_H
+#define ATOMIC_H
+
+#include "types.h"
+
+typedef struct {
+    volatile uint32_t v;
+} atomic_u32_t;
+
+typedef struct {
+    void *volatile v;
+} atomic_ptr_t;
+
+static __inline uint32_t atomic_u32_load(const atomic_u32_t *a) {
+    return __atomic_load_n(&a->v, __ATOMIC_ACQUIRE);
+}
+
+static __inline void atomic_u32_store(atomic_u32_t *a, uint32_t v) {
+    __atomic_store_n(&a->v, v, __ATOMIC_RELEASE);
+}
+
+/** @returns Integer previous value */
+static __inline uint32_t atomic_u32_add(atomic_u32_t *a, uint32_t v) {
+    return __atomic_fetch_add(&a->v, v, __ATOMIC_SEQ_CST);
+}
+
+/** @returns Integer previous value */
+static __inline uint32_t atomic_u32_sub(atomic_u32_t *a, uint32_t v) {
+    return __atomic_fetch_sub(&a->v, v, __ATOMIC_SEQ_CST);
+}
+
+/** @returns Integer previous value */
+static __inline uint32_t atomic_u32_or(atomic_u32_t *a, uint32_t mask) {
+    return __atomic_fetch_or(&a->v, mask, __ATOMIC_SEQ_CST);
+}
+
+/** @returns Integer previous value */
+static __inline uint32_t atomic_u32_and(atomic_u32_t *a, uint32_t mask) {
+    return __atomic_fetch_and(&a->v, mask, __ATOMIC_SEQ_CST);
+}
+
+/** @returns Integer previous value */
+static __inline uint32_t atomic_u32_xchg(atomic_u32_t *a, uint32_t v) {
+    return __atomic_exchange_n(&a->v, v, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Replaces *expect with v if the value still equals *expect.
+ * On failure, *expect is updated to the current value.
+ * @returns 1 on success, 0 otherwise
+ */
+static __inline uint32_t atomic_u32_cas(atomic_u32_t *a, uint32_t *expect,
+                                        uint32_t v) {
+    return __atomic_compare_exchange_n(&a->v, expect, v, 0, __ATOMIC_SEQ_CST,
+                                       __ATOMIC_RELAXED);
+}
+
+static __inline void *atomic_ptr_load(const atomic_ptr_t *a) {
+    return __atomic_load_n(&a->v, __ATOMIC_ACQUIRE);
+}
+
+static __inline void atomic_ptr_store(atomic_ptr_t *a, void *v) {
+    __atomic_store_n(&a->v, v, __ATOMIC_RELEASE);
+}
+
+/** @returns Previous pointer */
+static __inline void *atomic_ptr_xchg(atomic_ptr_t *a, void *v) {
+    return __atomic_exchange_n(&a->v, v, __ATOMIC_SEQ_CST);
+}
+
+/** @see atomic_u32_cas */
+static __inline uint32_t atomic_ptr_cas(atomic_ptr_t *a, void **expect,
+                                        void *v) {
+    return __atomic_compare_exchange_n(&a->v, expect, v, 0, __ATOMIC_SEQ_CST,
+                                       __ATOMIC_RELAXED);
+}
+
+#endif
@@ -0,0 +1,91 @@
+/**
+ * @file bench.c
+ * @brief Implements the benchmark harness.
+ * @author Herbie Rand
+ */
+
+#include "bench.h"
+#include "asm.h"
+#include "riscv.h"
+#include "types.h"
+#include "uart.h"
+
+static uint32_t cycles[BENCH_MAX_RUNS];
+static uint32_t instret[BENCH_MAX_RUNS];
+
+static void _stat(uint32_t *v, uint32_t n, bench_stat_t *st);
+static void _put_stat(const char *key, const bench_stat_t *st);
+
+void bench_init() {
+    // let U-mode read cycle (CY) and instret (IR)
+    csr_write(mcounteren, 0x5);
+    pmp_user_init();
+}
+
+void bench_run(const char *name, bench_fn_t fn, void *arg, uint32_t runs,
+               bench_result_t *out) {
+    bench_sample_t s;
+    bench_result_t r;
+
+    if (!runs || runs > BENCH_MAX_RUNS) {
+        breakpoint();
+    }
+
+    // the first run fills caches and branch predictors
+    fn(&s, arg);
+    for (uint32_t i = 0; i < runs; i++) {
+        fn(&s, arg);
+        cycles[i] = s.cycles;
+        instret[i] = s.instret;
+    }
+
+    r.name = name;
+    r.runs = runs;
+    _stat(cycles, runs, &r.cycles);
+    _stat(instret, runs, &r.instret);
+    bench_report(&r);
+    if (out) {
+        *out = r;
+    }
+}
+
+void bench_report(const bench_result_t *r) {
+    uart_puts("@bench name=");
+    uart_puts(r->name);
+    uart_puts(" runs=");
+    uart_putu(r->runs);
+    _put_stat(" cycles=", &r->cycles);
+    _put_stat(" instret=", &r->instret);
+    uart_puts("\r\n");
+}
+
+void bench_done() {
+    uart_puts("@bench-done\r\n");
+    uart_flush();
+}
+
+// Sorts v in place, insertion sort is plenty for BENCH_MAX_RUNS
+static void _stat(uint32_t *v, uint32_t n, bench_stat_t *st) {
+    uint32_t x;
+    uint32_t j;
+
+    for (uint32_t i = 1; i < n; i++) {
+        x = v[i];
+        for (j = i; j && v[j - 1] > x; j--) {
+            v[j] = v[j - 1];
+        }
+        v[j] = x;
+    }
+    st->min = v[0];
+    st->median = v[n / 2];
+    st->max = v[n - 1];
+}
+
+static void _put_stat(const char *key, const bench_stat_t *st) {
+    uart_puts(key);
+    uart_putu(st->min);
+    uart_putc('/');
+    uart_putu(st->median);
+    uart_putc('/');
+    uart_putu(st->max);
+}
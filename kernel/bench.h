@@ -0,0 +1,102 @@
+/**
+ * @file bench.h
+ * @brief On-target benchmark harness.
+ *
+ * A benchmark case is a function that runs the code under test once and
+ * times the interesting region with bench_begin/bench_end, which may be
+ * called from different places, e.g. before raising an interrupt and at the
+ * top of its handler. bench_run calls a case many times and reports the
+ * min, median and max of mcycle and minstret deltas over the UART, one
+ * record per line:
+ *
+ *     @bench name=<name> runs=<n> cycles=<min>/<median>/<max> instret=<...>
+ *
+ * and bench_done ends the report with `@bench-done`. `make console` turns
+ * the records into a CSV or JSON report, see console/main.py.
+ *
+ * Samples include the cost of reading the counters, which the `empty` case
+ * of test_bench measures.
+ *
+ * @author Herbie Rand
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "riscv.h"
+#include "types.h"
+
+/** @brief Maximum number of runs per case */
+#define BENCH_MAX_RUNS 256
+
+typedef struct {
+    uint32_t cycles;
+    uint32_t instret;
+} bench_sample_t;
+
+typedef struct {
+    uint32_t min;
+    uint32_t median;
+    uint32_t max;
+} bench_stat_t;
+
+typedef struct {
+    const char *name;
+    uint32_t runs;
+    bench_stat_t cycles;
+    bench_stat_t instret;
+} bench_result_t;
+
+/**
+ * @brief Benchmark case. Runs the code under test once, timing it into s.
+ * @param s     Sample to fill in with bench_begin/bench_end
+ * @param arg   Argument given to bench_run
+ */
+typedef void (*bench_fn_t)(bench_sample_t *s, void *arg);
+
+/**
+ * @brief Starts timing a sample.
+ */
+static __inline void bench_begin(bench_sample_t *s) {
+    s->instret = csr_read(minstret);
+    s->cycles = csr_read(mcycle);
+}
+
+/**
+ * @brief Stops timing a sample, leaving the deltas in it.
+ */
+static __inline void bench_end(bench_sample_t *s) {
+    s->cycles = csr_read(mcycle) - s->cycles;
+    s->instret = csr_read(minstret) - s->instret;
+}
+
+/**
+ * @brief Prepares for benchmarking: lets U-mode read cycle and instret, and
+ *        sets up PMP for cases that drop to U-mode via `user_call`.
+ * The UART must already be initialized.
+ */
+void bench_init();
+
+/**
+ * @brief Runs a case once to warm up, then runs times more, and reports
+ *        the statistics over the UART.
+ * @param name  Case name, without spaces
+ * @param fn    Case function
+ * @param arg   Argument passed to fn
+ * @param runs  Integer number of timed runs, up to BENCH_MAX_RUNS
+ * @param out   Filled in with the statistics if not 0
+ */
+void bench_run(const char *name, bench_fn_t fn, void *arg, uint32_t runs,
+               bench_result_t *out);
+
+/**
+ * @brief Sends a result record over the UART.
+ */
+void bench_report(const bench_result_t *r);
+
+/**
+ * @brief Marks the end of the report, and waits for the UART to drain.
+ */
+void bench_done();
+
+#endif
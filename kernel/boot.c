@@ -0,0 +1,54 @@
+/**
+ * @file boot.c
+ * @brief Implements the fast boot sequence.
+ * @author Herbie Rand
+ */
+
+#include "boot.h"
+#include "asm.h"
+#include "clock.h"
+#include "resets.h"
+#include "rp2350.h"
+#include "types.h"
+#include "uart.h"
+
+uint32_t boot_stamps[BOOT_PHASES];
+
+static const char *names[BOOT_PHASES] = {
+    [BOOT_XIP] "xip",       [BOOT_COPY] "copy",     [BOOT_BSS] "bss",
+    [BOOT_MAIN] "main",     [BOOT_RESETS] "resets", [BOOT_CLOCKS] "clocks",
+    [BOOT_READY] "ready",
+};
+
+void boot_init() {
+    // the XOSC needs ~1 ms to start, let it run while resets are released
+    xosc_start();
+    initial_reset_cycle();
+    boot_stamp(BOOT_RESETS);
+
+    clock_defaults_set();
+    boot_stamp(BOOT_CLOCKS);
+
+    postclk_reset_cycle();
+    boot_stamp(BOOT_READY);
+}
+
+void boot_stamp(uint32_t phase) {
+    if (phase >= BOOT_PHASES) {
+        breakpoint();
+    }
+    if (!boot_stamps[phase]) {
+        boot_stamps[phase] = AT(SIO_MTIME);
+    }
+}
+
+void boot_report() {
+    uart_puts("@boot");
+    for (uint32_t i = 0; i < BOOT_PHASES; i++) {
+        uart_putc(' ');
+        uart_puts(names[i]);
+        uart_putc('=');
+        uart_putu(boot_stamps[i]);
+    }
+    uart_puts("\r\n");
+}
@@ -0,0 +1,70 @@
+/**
+ * @file boot.h
+ * @brief Fast boot sequence and boot-phase timestamps.
+ *
+ * _reset_handler stamps the phases up to main, and boot_init the ones after
+ * it. Stamps are the low word of mtime, in microseconds since mtime was
+ * started at the top of _reset_handler. Until clock_defaults_set, mtime
+ * runs from the ROSC, so those stamps are only as accurate as the ROSC.
+ * Time spent in the bootrom before _reset_handler is not included.
+ *
+ * Inspect boot_stamps from the debugger, or send them with boot_report.
+ *
+ * NOTE: phase numbers are also used by startup.S.
+ *
+ * @author Herbie Rand
+ */
+
+#ifndef BOOT_H
+#define BOOT_H
+
+/** @brief XIP set up, flash is fast to read */
+#define BOOT_XIP 0
+/** @brief .data and .time_critical copied to SRAM */
+#define BOOT_COPY 1
+/** @brief .bss zeroed */
+#define BOOT_BSS 2
+/** @brief About to enter main */
+#define BOOT_MAIN 3
+/** @brief Peripherals taken through reset by boot_init */
+#define BOOT_RESETS 4
+/** @brief XOSC, PLLs and clocks configured by boot_init */
+#define BOOT_CLOCKS 5
+/** @brief Clock-dependent peripherals out of reset, boot_init done */
+#define BOOT_READY 6
+
+#define BOOT_PHASES 7
+
+#ifndef __ASSEMBLER__
+
+#include "types.h"
+
+/** @brief Timestamp of each phase, 0 until reached */
+extern uint32_t boot_stamps[BOOT_PHASES];
+
+/**
+ * @brief Brings up resets and clocks, replacing initial_reset_cycle,
+ *        clock_defaults_set and postclk_reset_cycle.
+ * The XOSC starts up while the peripheral resets are released, and both
+ * PLLs lock at the same time. Stamps BOOT_RESETS, BOOT_CLOCKS and
+ * BOOT_READY.
+ */
+void boot_init();
+
+/**
+ * @brief Records the current time as the timestamp of a phase, unless the
+ *        phase was already reached.
+ * @param phase Integer phase, BOOT_*
+ */
+void boot_stamp(uint32_t phase);
+
+/**
+ * @brief Sends the timestamps over the UART, which must be initialized, as
+ *
+ *     @boot xip=<us> copy=<us> bss=<us> main=<us> resets=<us> ...
+ */
+void boot_report();
+
+#endif
+
+#endif
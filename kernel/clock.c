@@ -1,5 +1,6 @@
 #include "clock.h"
 #include "asm.h"
+#include "mtime.h"
 #include "resets.h"
 
 static uint32_t _clk_sys_freq_mhz = 0;
@@ -11,17 +12,21 @@ static void _refsys_config(uint32_t rctrl, uint32_t rselected, uint32_t rdiv,
 static void _nonsys_config(uint32_t rctrl, uint32_t rselected, uint32_t rdiv,
                            uint32_t auxsrc, uint32_t div);
 
-static void _pll_init(uint32_t rcs, uint32_t rfbdiv, uint32_t rprim,
-                      uint32_t rpwr, void (*reset)(), uint32_t refdiv,
-                      uint32_t vcofreq, uint32_t postdiv1, uint32_t postdiv2);
+static void _pll_start(uint32_t rcs, uint32_t rfbdiv, uint32_t rprim,
+                       uint32_t rpwr, void (*reset)(), uint32_t refdiv,
+                       uint32_t vcofreq, uint32_t postdiv1, uint32_t postdiv2);
+
+static void _pll_finish(uint32_t rcs, uint32_t rprim, uint32_t rpwr,
+                        uint32_t postdiv1, uint32_t postdiv2);
 
 // Initializes high-precision clocks for CLK_SYS, CLK_REF, CLK_PERI...
 // Adapted from SDK and datasheet
 void clock_defaults_set() {
     AT(CLOCKS_CLK_SYS_RESUS_CTRL) = 0;
 
-    // Enable the xosc
-    xosc_init();
+    // Enable the xosc, unless boot_init already started it
+    xosc_start();
+    xosc_wait();
 
     // Before we touch PLLs, switch sys and ref cleanly away from their aux
     // sources. switch CLK_SYS, CLK_REF away from AUX clocks if required
@@ -33,10 +38,19 @@ void clock_defaults_set() {
     while (AT(CLOCKS_CLK_REF_SELECTED) != 0x1)
         ;
 
-    pll_sys_init(PLL_SYS_REFDIV, PLL_SYS_VCO_FREQ_HZ, PLL_SYS_POSTDIV1,
-                 PLL_SYS_POSTDIV2);
-    pll_usb_init(PLL_USB_REFDIV, PLL_USB_VCO_FREQ_HZ, PLL_USB_POSTDIV1,
-                 PLL_USB_POSTDIV2);
+    // reset both PLLs at once, then let them lock at the same time rather
+    // than one after the other
+    pll_reset_cycle();
+    _pll_start(PLL_SYS_CS, PLL_SYS_FBDIV_INT, PLL_SYS_PRIM, PLL_SYS_PWR, 0,
+               PLL_SYS_REFDIV, PLL_SYS_VCO_FREQ_HZ, PLL_SYS_POSTDIV1,
+               PLL_SYS_POSTDIV2);
+    _pll_start(PLL_USB_CS, PLL_USB_FBDIV_INT, PLL_USB_PRIM, PLL_USB_PWR, 0,
+               PLL_USB_REFDIV, PLL_USB_VCO_FREQ_HZ, PLL_USB_POSTDIV1,
+               PLL_USB_POSTDIV2);
+    _pll_finish(PLL_SYS_CS, PLL_SYS_PRIM, PLL_SYS_PWR, PLL_SYS_POSTDIV1,
+                PLL_SYS_POSTDIV2);
+    _pll_finish(PLL_USB_CS, PLL_USB_PRIM, PLL_USB_PWR, PLL_USB_POSTDIV1,
+                PLL_USB_POSTDIV2);
 
     clk_ref_config(CLK_REF_SRC_DEFAULT, CLK_REF_AUXSRC_DEFAULT,
                    CLK_REF_DIV_DEFAULT);
@@ -50,6 +64,9 @@ void clock_defaults_set() {
     clk_usb_config(CLK_USB_AUXSRC_DEFAULT, CLK_USB_DIV_DEFAULT);
     clk_adc_config(CLK_ADC_AUXSRC_DEFAULT, CLK_ADC_DIV_DEFAULT);
     clk_hstx_config(CLK_HSTX_AUXSRC_DEFAULT, CLK_HSTX_DIV_DEFAULT);
+
+    // clk_ref now runs from the XOSC, keep mtime at its nominal rate
+    mtime_calibrate();
 }
 
 uint32_t clk_sys_freq_mhz() {
@@ -119,8 +136,17 @@ void clk_hstx_config(uint32_t auxsrc, uint32_t div) {
 }
 
 void xosc_init() {
+    xosc_start();
+    xosc_wait();
+}
+
+void xosc_start() {
     uint32_t xosc_ctrl;
 
+    if ((AT(XOSC_CTRL) & XOSC_CTRL_ENABLE_BITS) == XOSC_CTRL_ENABLE_VALUE) {
+        return;
+    }
+
     // configure XOSC
     AT(XOSC_CTRL) = XOSC_CTRL_DISABLE_VALUE | XOSC_1_15MHZ_RANGE;
     AT(XOSC_STARTUP) = XOSC_STARTUP_DELAY;
@@ -128,7 +154,9 @@ void xosc_init() {
     // enable XOSC
     xosc_ctrl = AT(XOSC_CTRL) & ~XOSC_CTRL_ENABLE_BITS;
     AT(XOSC_CTRL) = xosc_ctrl | XOSC_CTRL_ENABLE_VALUE;
+}
 
+void xosc_wait() {
     // block until XOSC is stable
     while (!(AT(XOSC_STATUS) & XOSC_STATUS_STABLE))
         ;
@@ -136,14 +164,16 @@ void xosc_init() {
 
 void pll_sys_init(uint32_t refdiv, uint32_t vcofreq, uint32_t postdiv1,
                   uint32_t postdiv2) {
-    _pll_init(PLL_SYS_CS, PLL_SYS_FBDIV_INT, PLL_SYS_PRIM, PLL_SYS_PWR,
-              pll_sys_reset_cycle, refdiv, vcofreq, postdiv1, postdiv2);
+    _pll_start(PLL_SYS_CS, PLL_SYS_FBDIV_INT, PLL_SYS_PRIM, PLL_SYS_PWR,
+               pll_sys_reset_cycle, refdiv, vcofreq, postdiv1, postdiv2);
+    _pll_finish(PLL_SYS_CS, PLL_SYS_PRIM, PLL_SYS_PWR, postdiv1, postdiv2);
 }
 
 void pll_usb_init(uint32_t refdiv, uint32_t vcofreq, uint32_t postdiv1,
                   uint32_t postdiv2) {
-    _pll_init(PLL_USB_CS, PLL_USB_FBDIV_INT, PLL_USB_PRIM, PLL_USB_PWR,
-              pll_usb_reset_cycle, refdiv, vcofreq, postdiv1, postdiv2);
+    _pll_start(PLL_USB_CS, PLL_USB_FBDIV_INT, PLL_USB_PRIM, PLL_USB_PWR,
+               pll_usb_reset_cycle, refdiv, vcofreq, postdiv1, postdiv2);
+    _pll_finish(PLL_USB_CS, PLL_USB_PRIM, PLL_USB_PWR, postdiv1, postdiv2);
 }
 
 // Some comments from SDK. Adapted from SDK
@@ -203,9 +233,11 @@ static void _nonsys_config(uint32_t rctrl, uint32_t rselected, uint32_t rdiv,
     // TODO: save frequency
 }
 
-static void _pll_init(uint32_t rcs, uint32_t rfbdiv, uint32_t rprim,
-                      uint32_t rpwr, void (*reset)(), uint32_t refdiv,
-                      uint32_t vcofreq, uint32_t postdiv1, uint32_t postdiv2) {
+// Checks and programs the dividers, then powers the VCO on without waiting
+// for lock. reset, if not 0, cycles the PLL block first.
+static void _pll_start(uint32_t rcs, uint32_t rfbdiv, uint32_t rprim,
+                       uint32_t rpwr, void (*reset)(), uint32_t refdiv,
+                       uint32_t vcofreq, uint32_t postdiv1, uint32_t postdiv2) {
     uint32_t reffreq;
     uint32_t fbdiv;
     uint32_t pdiv;
@@ -236,7 +268,9 @@ static void _pll_init(uint32_t rcs, uint32_t rfbdiv, uint32_t rprim,
     }
 
     // reset PLL block
-    reset();
+    if (reset) {
+        reset();
+    }
 
     // set dividers
     AT(rcs) = refdiv;
@@ -244,6 +278,12 @@ static void _pll_init(uint32_t rcs, uint32_t rfbdiv, uint32_t rprim,
 
     // power on PLL (VOCPD, PD)
     AT(rpwr + ATOMIC_BITCLR_OFFSET) = (1 << 5) | 1;
+}
+
+// Waits for the PLL started by _pll_start to lock, then enables its output
+static void _pll_finish(uint32_t rcs, uint32_t rprim, uint32_t rpwr,
+                        uint32_t postdiv1, uint32_t postdiv2) {
+    uint32_t pdiv = (postdiv1 << 16) | (postdiv2 << 12);
 
     // wait for PLL to lock
     while (!(AT(rcs) & PLL_CS_LOCK_MASK))
@@ -119,6 +119,18 @@ void clk_hstx_config(uint32_t auxsrc, uint32_t div);
  */
 void xosc_init();
 
+/**
+ * @brief Starts the XOSC without waiting for it to stabilize, so that other
+ *        work may overlap its startup delay. Does nothing if it is already
+ *        enabled.
+ */
+void xosc_start();
+
+/**
+ * @brief Blocks until the XOSC started by xosc_start is stable.
+ */
+void xosc_wait();
+
 /**
  * @brief Initializes SYS pll.
  * @param refdiv Integer reference divisor
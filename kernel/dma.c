@@ -0,0 +1,265 @@
+/**
+ * @file dma.c
+ * @brief Implements the DMA subsystem.
+ * @author Herbie Rand
+ */
+
+#include "dma.h"
+#include "asm.h"
+#include "rp2350.h"
+#include "types.h"
+
+#define CH(ch, reg) AT(DMA_BASE + (ch) * DMA_CH_STRIDE + (reg))
+
+static struct {
+    void (*done)(void *);
+    void *arg;
+    /** @brief Source word for dma_memset */
+    uint32_t fill;
+    /** @brief Unclaim the channel on completion */
+    uint32_t release;
+} chan[DMA_CHANNELS];
+
+/** @brief Bitmap of claimed channels */
+static uint32_t claimed;
+
+static void _start(uint32_t ch, const dma_cb_t *cb, void (*done)(void *),
+                   void *arg, uint32_t release);
+static void _arm(uint32_t ch, void (*done)(void *), void *arg,
+                 uint32_t release);
+static uint32_t _size(uint32_t a, uint32_t b, uint32_t n);
+
+uint32_t dma_ctrl(uint32_t size, uint32_t flags, uint32_t dreq) {
+    if (size > DMA_SIZE_32 || dreq > DREQ_FORCE) {
+        breakpoint();
+    }
+    return DMA_CTRL_EN | (size << DMA_CTRL_DATA_SIZE_SHIFT) | flags |
+           (dreq << DMA_CTRL_TREQ_SEL_SHIFT);
+}
+
+int32_t dma_claim() {
+    uint32_t mie = irq_save();
+    uint32_t free = ~claimed & ((1UL << DMA_CHANNELS) - 1);
+    int32_t ch = -1;
+
+    if (free) {
+        ch = __builtin_ctz(free);
+        claimed |= (1UL << ch);
+    }
+    irq_restore(mie);
+    return ch;
+}
+
+void dma_unclaim(uint32_t ch) {
+    uint32_t mie = irq_save();
+
+    claimed &= ~(1UL << ch);
+    irq_restore(mie);
+}
+
+void dma_start(uint32_t ch, const dma_cb_t *cb, void (*done)(void *),
+               void *arg) {
+    _start(ch, cb, done, arg, 0);
+}
+
+void dma_start_chain(uint32_t ch, uint32_t ctl, dma_cb_t *list,
+                     void (*done)(void *), void *arg) {
+    dma_cb_t *cb = list;
+
+    // each block chains back to the control channel, and only the null
+    // trigger of the final count 0 block raises the IRQ
+    for (;;) {
+        cb->ctrl = (cb->ctrl & ~DMA_CTRL_CHAIN_TO_MASK) | DMA_CTRL_EN |
+                   DMA_CTRL_IRQ_QUIET | (ctl << DMA_CTRL_CHAIN_TO_SHIFT);
+        if (!cb->count) {
+            break;
+        }
+        cb++;
+    }
+
+    _arm(ch, done, arg, 0);
+
+    // the control channel copies 4 words into the data channel's AL1 alias,
+    // wrapping its write address on 16 bytes, then stops until chained to
+    CH(ctl, DMA_READ_ADDR) = (uint32_t)list;
+    CH(ctl, DMA_WRITE_ADDR) = DMA_BASE + ch * DMA_CH_STRIDE + DMA_AL1_CTRL;
+    CH(ctl, DMA_TRANS_COUNT) = 4;
+    CH(ctl, DMA_CTRL_TRIG) =
+        dma_ctrl(DMA_SIZE_32, DMA_CTRL_INCR_READ | DMA_CTRL_INCR_WRITE,
+                 DREQ_FORCE) |
+        (4 << DMA_CTRL_RING_SIZE_SHIFT) | DMA_CTRL_RING_SEL |
+        (ctl << DMA_CTRL_CHAIN_TO_SHIFT);
+}
+
+uint32_t dma_busy(uint32_t ch) {
+    return (CH(ch, DMA_CTRL_TRIG) & DMA_CTRL_BUSY) ? 1 : 0;
+}
+
+void dma_wait(uint32_t ch) {
+    while (dma_busy(ch))
+        ;
+}
+
+void dma_abort(uint32_t ch) {
+    AT(DMA_INTE0 + ATOMIC_BITCLR_OFFSET) = (1UL << ch);
+    AT(DMA_CHAN_ABORT) = (1UL << ch);
+    while (AT(DMA_CHAN_ABORT) & (1UL << ch))
+        ;
+    // an abort may still raise the completion interrupt
+    AT(DMA_INTS0) = (1UL << ch);
+    chan[ch].done = 0;
+    if (chan[ch].release) {
+        dma_unclaim(ch);
+    }
+}
+
+int32_t dma_memcpy(void *dst, const void *src, uint32_t n,
+                   void (*done)(void *), void *arg) {
+    int32_t ch = dma_claim();
+    uint32_t size = _size((uint32_t)dst, (uint32_t)src, n);
+    dma_cb_t cb;
+
+    if (ch < 0) {
+        return ch;
+    }
+    cb.ctrl =
+        dma_ctrl(size, DMA_CTRL_INCR_READ | DMA_CTRL_INCR_WRITE, DREQ_FORCE);
+    cb.read = (uint32_t)src;
+    cb.write = (uint32_t)dst;
+    cb.count = n >> size;
+    _start(ch, &cb, done, arg, 1);
+    return ch;
+}
+
+int32_t dma_memset(void *dst, uint8_t c, uint32_t n, void (*done)(void *),
+                   void *arg) {
+    int32_t ch = dma_claim();
+    uint32_t size = _size((uint32_t)dst, 0, n);
+    dma_cb_t cb;
+
+    if (ch < 0) {
+        return ch;
+    }
+    // the source does not increment, so read the same word over and over
+    chan[ch].fill = (uint32_t)c * 0x01010101;
+    cb.ctrl = dma_ctrl(size, DMA_CTRL_INCR_WRITE, DREQ_FORCE);
+    cb.read = (uint32_t)&chan[ch].fill;
+    cb.write = (uint32_t)dst;
+    cb.count = n >> size;
+    _start(ch, &cb, done, arg, 1);
+    return ch;
+}
+
+int32_t dma_to_periph(uint32_t reg, const void *src, uint32_t n,
+                      uint32_t size, uint32_t dreq, void (*done)(void *),
+                      void *arg) {
+    int32_t ch = dma_claim();
+    dma_cb_t cb;
+
+    if (ch < 0) {
+        return ch;
+    }
+    cb.ctrl = dma_ctrl(size, DMA_CTRL_INCR_READ, dreq);
+    cb.read = (uint32_t)src;
+    cb.write = reg;
+    cb.count = n;
+    _start(ch, &cb, done, arg, 1);
+    return ch;
+}
+
+int32_t dma_from_periph(void *dst, uint32_t reg, uint32_t n, uint32_t size,
+                        uint32_t dreq, void (*done)(void *), void *arg) {
+    int32_t ch = dma_claim();
+    dma_cb_t cb;
+
+    if (ch < 0) {
+        return ch;
+    }
+    cb.ctrl = dma_ctrl(size, DMA_CTRL_INCR_WRITE, dreq);
+    cb.read = reg;
+    cb.write = (uint32_t)dst;
+    cb.count = n;
+    _start(ch, &cb, done, arg, 1);
+    return ch;
+}
+
+/**
+ * @brief DMA_IRQ_0 handler, overrides the weak definition in startup.S.
+ */
+void isr_irq10() {
+    uint32_t ints = AT(DMA_INTS0);
+    void (*done)(void *);
+    void *arg;
+    uint32_t ch;
+
+    AT(DMA_INTS0) = ints;
+    while (ints) {
+        ch = __builtin_ctz(ints);
+        ints &= ints - 1;
+
+        if (CH(ch, DMA_CTRL_TRIG) & DMA_CTRL_ERR_MASK) {
+            breakpoint();
+        }
+        AT(DMA_INTE0 + ATOMIC_BITCLR_OFFSET) = (1UL << ch);
+        done = chan[ch].done;
+        arg = chan[ch].arg;
+        chan[ch].done = 0;
+        // release first, so done may start another transfer on it
+        if (chan[ch].release) {
+            dma_unclaim(ch);
+        }
+        if (done) {
+            done(arg);
+        }
+    }
+}
+
+static void _start(uint32_t ch, const dma_cb_t *cb, void (*done)(void *),
+                   void *arg, uint32_t release) {
+    // a count of 0 is a null trigger, which never completes
+    if (!cb->count) {
+        if (release) {
+            dma_unclaim(ch);
+        }
+        if (done) {
+            done(arg);
+        }
+        return;
+    }
+    _arm(ch, done, arg, release);
+
+    // a channel chained to itself does not chain
+    CH(ch, DMA_AL1_CTRL) = (cb->ctrl & ~DMA_CTRL_CHAIN_TO_MASK) |
+                           (ch << DMA_CTRL_CHAIN_TO_SHIFT);
+    CH(ch, DMA_AL1_READ_ADDR) = cb->read;
+    CH(ch, DMA_AL1_WRITE_ADDR) = cb->write;
+    CH(ch, DMA_AL1_TRANS_COUNT) = cb->count;
+}
+
+// Records the completion callback, and enables the channel's interrupt if
+// anything has to happen on completion
+static void _arm(uint32_t ch, void (*done)(void *), void *arg,
+                 uint32_t release) {
+    chan[ch].done = done;
+    chan[ch].arg = arg;
+    chan[ch].release = release;
+
+    AT(DMA_INTS0) = (1UL << ch);
+    if (done || release) {
+        AT(DMA_INTE0 + ATOMIC_BITSET_OFFSET) = (1UL << ch);
+        irq_enable(DMA_IRQ_0);
+    }
+}
+
+// Widest transfer size both addresses and the length are aligned to
+static uint32_t _size(uint32_t a, uint32_t b, uint32_t n) {
+    uint32_t bits = a | b | n;
+
+    if (!(bits & 3)) {
+        return DMA_SIZE_32;
+    }
+    if (!(bits & 1)) {
+        return DMA_SIZE_16;
+    }
+    return DMA_SIZE_8;
+}
@@ -0,0 +1,145 @@
+/**
+ * @file dma.h
+ * @brief DMA channel allocator, paced and chained transfers, and async
+ *        memcpy/memset.
+ *
+ * Transfers complete through DMA_IRQ_0, which calls the `done` callback
+ * passed when the transfer was started, in interrupt context.
+ *
+ * @author Herbie Rand
+ */
+#ifndef DMA_H
+#define DMA_H
+
+#include "types.h"
+
+#define DMA_CHANNELS 16
+
+/** @brief Transfer sizes for dma_ctrl */
+#define DMA_SIZE_8  0
+#define DMA_SIZE_16 1
+#define DMA_SIZE_32 2
+
+/**
+ * @brief One transfer, laid out like a channel's AL1 register alias so a
+ *        control channel can copy it straight into the channel. Writing
+ *        count triggers the transfer.
+ */
+typedef struct {
+    /** @brief CTRL value, see dma_ctrl */
+    uint32_t ctrl;
+    /** @brief Integer source address */
+    uint32_t read;
+    /** @brief Integer destination address */
+    uint32_t write;
+    /** @brief Integer number of transfers (not bytes) */
+    uint32_t count;
+} dma_cb_t;
+
+/**
+ * @brief Builds a CTRL value for a dma_cb_t.
+ * @param size      One of DMA_SIZE_<X>
+ * @param flags     DMA_CTRL_INCR_READ and/or DMA_CTRL_INCR_WRITE, etc.
+ * @param dreq      Integer DREQ pacing the transfer, or DREQ_FORCE
+ * @returns Integer CTRL value
+ */
+uint32_t dma_ctrl(uint32_t size, uint32_t flags, uint32_t dreq);
+
+/**
+ * @brief Claims a free DMA channel.
+ * @returns Integer channel, or -1 if none are free
+ */
+int32_t dma_claim();
+
+/**
+ * @brief Releases a claimed DMA channel. It must not be busy.
+ * @param ch    Integer channel
+ */
+void dma_unclaim(uint32_t ch);
+
+/**
+ * @brief Starts a single transfer on a claimed channel.
+ * @param ch    Integer channel
+ * @param cb    Transfer, may be reused once this returns
+ * @param done  Completion callback, or 0
+ * @param arg   Argument passed to done
+ */
+void dma_start(uint32_t ch, const dma_cb_t *cb, void (*done)(void *),
+               void *arg);
+
+/**
+ * @brief Starts a scatter-gather list of transfers. The control channel
+ *        loads each block into the data channel, which chains back to it.
+ * The list is terminated by a block with count 0, and must stay valid until
+ * done is called. CTRL chaining fields of every block are overwritten.
+ * @param ch    Integer data channel
+ * @param ctl   Integer control channel
+ * @param list  Transfers, terminated by a block with count 0
+ * @param done  Completion callback, or 0
+ * @param arg   Argument passed to done
+ */
+void dma_start_chain(uint32_t ch, uint32_t ctl, dma_cb_t *list,
+                     void (*done)(void *), void *arg);
+
+/**
+ * @brief Checks whether a channel is still transferring.
+ * @param ch    Integer channel
+ * @returns 1 if busy, 0 otherwise
+ */
+uint32_t dma_busy(uint32_t ch);
+
+/**
+ * @brief Busy-waits for a channel to finish.
+ * @param ch    Integer channel
+ */
+void dma_wait(uint32_t ch);
+
+/**
+ * @brief Aborts an in-flight transfer. done is not called, but channels
+ *        claimed by the helpers below are released.
+ * @param ch    Integer channel
+ */
+void dma_abort(uint32_t ch);
+
+/**
+ * @brief Copies n bytes on a free channel, released again on completion.
+ * Uses the widest transfer size that dst, src and n are aligned to.
+ * @returns Integer channel, or -1 if none are free
+ */
+int32_t dma_memcpy(void *dst, const void *src, uint32_t n,
+                   void (*done)(void *), void *arg);
+
+/**
+ * @brief Fills n bytes with c on a free channel, released again on
+ *        completion.
+ * @returns Integer channel, or -1 if none are free
+ */
+int32_t dma_memset(void *dst, uint8_t c, uint32_t n, void (*done)(void *),
+                   void *arg);
+
+/**
+ * @brief Writes memory to a peripheral register, paced by its DREQ.
+ * @param reg   Integer register address
+ * @param src   Source buffer
+ * @param n     Integer number of transfers
+ * @param size  One of DMA_SIZE_<X>
+ * @param dreq  Integer DREQ of the peripheral
+ * @returns Integer channel, or -1 if none are free
+ */
+int32_t dma_to_periph(uint32_t reg, const void *src, uint32_t n,
+                      uint32_t size, uint32_t dreq, void (*done)(void *),
+                      void *arg);
+
+/**
+ * @brief Reads a peripheral register into memory, paced by its DREQ.
+ * @param dst   Destination buffer
+ * @param reg   Integer register address
+ * @param n     Integer number of transfers
+ * @param size  One of DMA_SIZE_<X>
+ * @param dreq  Integer DREQ of the peripheral
+ * @returns Integer channel, or -1 if none are free
+ */
+int32_t dma_from_periph(void *dst, uint32_t reg, uint32_t n, uint32_t size,
+                        uint32_t dreq, void (*done)(void *), void *arg);
+
+#endif
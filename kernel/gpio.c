@@ -4,23 +4,20 @@
 
 void gpio_init(uint32_t pin) {
     // select SIO function for the provided GPIO pin
-    uint32_t *ctrladdr = (uint32_t *)((IO_BANK0_BASE + 0x4) + (pin * 0x8));
-    *ctrladdr = SIO_FUNCSEL;
+    AT((IO_BANK0_BASE + 0x4) + (pin * 0x8)) = SIO_FUNCSEL;
 
     // remove pad isolation control with atomic XOR
-    uint32_t *padsaddr = (uint32_t *)((PADS_BANK0_BASE + 0x3004) + (pin * 0x4));
-    *padsaddr = 0x100;
+    AT((PADS_BANK0_BASE + 0x3004) + (pin * 0x4)) = 0x100;
 
     // enable output on GPIO pin
-    *(uint32_t *)SIO_GPIO_OE_SET = (1 << pin);
+    AT(SIO_GPIO_OE_SET) = (1 << pin);
 
     // clear GPIO pin initially
-    *(uint32_t *)SIO_GPIO_OUT_CLR = (1 << pin);
+    AT(SIO_GPIO_OUT_CLR) = (1 << pin);
 }
 
 void gpio_init_func(uint32_t pin, uint32_t funcsel) {
-    uint32_t *ctrladdr = (uint32_t *)((IO_BANK0_BASE + 0x4) + (pin * 0x8));
-    *ctrladdr = funcsel;
+    AT((IO_BANK0_BASE + 0x4) + (pin * 0x8)) = funcsel;
 
     // remove pad isolation control with atomic XOR
     // uint32_t *padsaddr = (uint32_t *)((PADS_BANK0_BASE + 0x3004) + (pin *
@@ -30,11 +27,11 @@ void gpio_init_func(uint32_t pin, uint32_t funcsel) {
 }
 
 void gpio_set(uint32_t pin) {
-    *(uint32_t *)SIO_GPIO_OUT_SET = (1 << pin);
+    AT(SIO_GPIO_OUT_SET) = (1 << pin);
 }
 
 void gpio_clr(uint32_t pin) {
-    *(uint32_t *)SIO_GPIO_OUT_CLR = (1 << pin);
+    AT(SIO_GPIO_OUT_CLR) = (1 << pin);
 }
 
 void gpio_set_func(uint32_t pin, uint32_t fn) {
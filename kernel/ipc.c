@@ -0,0 +1,140 @@
+/**
+ * @file ipc.c
+ * @brief Implements inter-core channels.
+ *
+ * A core that is about to sleep raises a want flag, then re-checks the ring.
+ * The other core updates the ring, then checks the flag. Both sides fence
+ * in between, so at least one of them sees the other's update, and a
+ * sleeping core always gets its doorbell.
+ *
+ * @author Herbie Rand
+ */
+
+#include "ipc.h"
+#include "asm.h"
+#include "atomic.h"
+#include "fifo.h"
+#include "ring.h"
+#include "riscv.h"
+#include "rp2350.h"
+#include "types.h"
+
+typedef struct {
+    spsc_t ring;
+    uint32_t buf[IPC_RING_SIZE];
+    /** @brief Receiver is waiting for data */
+    atomic_u32_t want_data;
+    /** @brief Sender is waiting for space */
+    atomic_u32_t want_space;
+} inbox_t;
+
+/** @brief Inbox of each core, written by the other one */
+static inbox_t inbox[2];
+
+static void _notify(atomic_u32_t *want);
+static void _sleep(uint32_t mie);
+
+void ipc_init() {
+    for (uint32_t i = 0; i < 2; i++) {
+        spsc_init(&inbox[i].ring, inbox[i].buf, IPC_RING_SIZE);
+        atomic_u32_store(&inbox[i].want_data, 0);
+        atomic_u32_store(&inbox[i].want_space, 0);
+    }
+}
+
+void ipc_enable() {
+    multicore_fifo_drain();
+    AT(SIO_FIFO_ST) = ST_WOF | ST_ROE;
+    irq_enable(SIO_IRQ_FIFO);
+    set_mie(MEI_MASK);
+}
+
+void ipc_send(const uint32_t *buf, uint32_t n) {
+    inbox_t *box = &inbox[csr_read(mhartid) ^ 1];
+    uint32_t mie;
+
+    for (;;) {
+        while (n && spsc_push(&box->ring, *buf)) {
+            buf++;
+            n--;
+        }
+        _notify(&box->want_data);
+        if (!n) {
+            return;
+        }
+
+        // inbox full, sleep until the receiver frees space
+        mie = irq_save();
+        atomic_u32_xchg(&box->want_space, 1);
+        if (spsc_count(&box->ring) == IPC_RING_SIZE) {
+            _sleep(mie);
+        }
+        irq_restore(mie);
+    }
+}
+
+uint32_t ipc_recv(uint32_t *buf, uint32_t n) {
+    inbox_t *box = &inbox[csr_read(mhartid)];
+    uint32_t got;
+    uint32_t mie;
+
+    for (;;) {
+        got = ipc_try_recv(buf, n);
+        if (got) {
+            return got;
+        }
+
+        mie = irq_save();
+        atomic_u32_xchg(&box->want_data, 1);
+        if (!spsc_count(&box->ring)) {
+            _sleep(mie);
+        }
+        irq_restore(mie);
+    }
+}
+
+uint32_t ipc_try_recv(uint32_t *buf, uint32_t n) {
+    inbox_t *box = &inbox[csr_read(mhartid)];
+    uint32_t got = 0;
+
+    while (got < n && spsc_pop(&box->ring, &buf[got])) {
+        got++;
+    }
+    if (got) {
+        _notify(&box->want_space);
+    }
+    return got;
+}
+
+/**
+ * @brief SIO_IRQ_FIFO handler, overrides the weak definition in startup.S.
+ * Doorbells only wake the core from wfi, so they are simply discarded.
+ */
+void isr_irq25() {
+    multicore_fifo_drain();
+    AT(SIO_FIFO_ST) = ST_WOF | ST_ROE;
+}
+
+// Rings the other core's doorbell if it raised the want flag
+static void _notify(atomic_u32_t *want) {
+    // order the ring update before reading the flag
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (!atomic_u32_load(want) || !atomic_u32_xchg(want, 0)) {
+        return;
+    }
+    // a full FIFO already holds doorbells the other core has yet to take
+    if (AT(SIO_FIFO_ST) & ST_RDY) {
+        AT(SIO_FIFO_WR) = 0;
+    }
+}
+
+// Sleeps with interrupts off. wfi still wakes on the pending doorbell, which
+// is taken in the window below. Without interrupts, the caller just polls.
+static void _sleep(uint32_t mie) {
+    if (!mie) {
+        return;
+    }
+    asm volatile("wfi");
+    irq_restore(mie);
+    irq_save();
+}
@@ -0,0 +1,59 @@
+/**
+ * @file ipc.h
+ * @brief Inter-core channels through shared SRAM rings.
+ *
+ * Each core has an inbox ring of IPC_RING_SIZE words that the other core
+ * writes. The SIO FIFO carries no payload, only doorbells that raise
+ * SIO_IRQ_FIFO on the other core, and only when that core is waiting for
+ * data or space. A burst of words therefore costs at most one doorbell, and
+ * both cores sleep in wfi while they wait.
+ *
+ * NOTE: the SIO FIFO is also used to launch core 1, so call ipc_enable only
+ * after `init_core1` returns (core 0) or from the launched code (core 1).
+ *
+ * @author Herbie Rand
+ */
+
+#ifndef IPC_H
+#define IPC_H
+
+#include "types.h"
+
+/** @brief Inbox capacity in words, a power of two */
+#define IPC_RING_SIZE 256
+
+/**
+ * @brief Initializes both inboxes. Call once, on core 0, before core 1
+ *        is launched.
+ */
+void ipc_init();
+
+/**
+ * @brief Enables doorbell interrupts on the calling core.
+ * mstatus.MIE must be set for them to be taken.
+ */
+void ipc_enable();
+
+/**
+ * @brief Sends words to the other core, sleeping while its inbox is full.
+ * @param buf   Words to send
+ * @param n     Integer number of words
+ */
+void ipc_send(const uint32_t *buf, uint32_t n);
+
+/**
+ * @brief Receives at least one word from the other core, sleeping until one
+ *        arrives, and at most n.
+ * @param buf   Buffer for received words
+ * @param n     Integer buffer size in words, must be nonzero
+ * @returns Integer number of words received
+ */
+uint32_t ipc_recv(uint32_t *buf, uint32_t n);
+
+/**
+ * @brief Receives whatever words are available, without sleeping.
+ * @returns Integer number of words received, possibly 0
+ */
+uint32_t ipc_try_recv(uint32_t *buf, uint32_t n);
+
+#endif
@@ -0,0 +1,35 @@
+/**
+ * @file irq.c
+ * @brief Implements runtime installation of IRQ handlers, see irq.h.
+ * @author Herbie Rand
+ */
+
+#include "irq.h"
+#include "asm.h"
+#include "rp2350.h"
+#include "types.h"
+
+static void _unhandled(void *ctx) {
+    (void)ctx;
+    breakpoint();
+}
+
+void irq_set_handler(uint32_t irq, irq_handler_t fn, void *ctx) {
+    irq_entry_t *e;
+    uint32_t mie;
+
+    if (irq >= NUM_IRQS) {
+        breakpoint();
+        return;
+    }
+    e = &__external_interrupt_table[irq];
+    // not between the two stores, on this core at least
+    mie = irq_save();
+    e->fn = fn;
+    e->ctx = ctx;
+    irq_restore(mie);
+}
+
+void irq_remove_handler(uint32_t irq) {
+    irq_set_handler(irq, _unhandled, 0);
+}
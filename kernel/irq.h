@@ -0,0 +1,56 @@
+/**
+ * @file irq.h
+ * @brief Installs external interrupt handlers at runtime.
+ *
+ * isr_mei (startup.S) dispatches through __external_interrupt_table, which
+ * holds a handler and a context pointer per IRQ and lives in SRAM. It
+ * starts out with the isr_irqN handlers linked in, the weak defaults
+ * hitting a breakpoint, so drivers may still define those instead.
+ * irq_set_handler replaces an entry at runtime, and the handler then gets
+ * its context pointer as its argument, so one handler may serve several
+ * devices.
+ *
+ * The table is shared by both cores. Enable state and priority are set per
+ * core, with irq_enable, irq_disable and irq_set_priority (asm.h).
+ *
+ * @author Herbie Rand
+ */
+
+#ifndef IRQ_H
+#define IRQ_H
+
+#include "rp2350.h"
+#include "types.h"
+
+/**
+ * @brief External interrupt handler, run with higher priorities enabled.
+ * @param ctx   Context pointer given to irq_set_handler
+ */
+typedef void (*irq_handler_t)(void *ctx);
+
+typedef struct {
+    irq_handler_t fn;
+    void *ctx;
+} irq_entry_t;
+
+extern irq_entry_t __external_interrupt_table[NUM_IRQS];
+
+/**
+ * @brief Installs the handler of an IRQ, in place of the current one.
+ * Disable the IRQ on both cores first if it may be taken meanwhile, or it
+ * may run with the old handler and the new context. Hits a breakpoint if
+ * irq is out of range.
+ * @param irq   Integer IRQ number
+ * @param fn    Handler
+ * @param ctx   Passed to fn on every interrupt
+ */
+void irq_set_handler(uint32_t irq, irq_handler_t fn, void *ctx);
+
+/**
+ * @brief Removes the handler of an IRQ. Taking it afterwards hits a
+ *        breakpoint, as with no isr_irqN defined, so disable it first.
+ * @param irq   Integer IRQ number
+ */
+void irq_remove_handler(uint32_t irq);
+
+#endif
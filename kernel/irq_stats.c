@@ -0,0 +1,118 @@
+/**
+ * @file irq_stats.c
+ * @brief Implements per-vector trap statistics, see irq_stats.h.
+ * @author Herbie Rand
+ */
+
+#include "irq_stats.h"
+#include "riscv.h"
+#include "runtime.h"
+#include "section.h"
+#include "types.h"
+#include "uart.h"
+
+#ifdef IRQ_STATS
+// a vector never preempts itself on a core, so its entry needs no lock
+static irq_stats_t stats[NUM_CORES][IRQ_STATS_VECTORS];
+
+static void _put_vec(uint32_t vec);
+#endif
+
+const irq_stats_t *irq_stats(uint32_t core, uint32_t vec) {
+#ifdef IRQ_STATS
+    return &stats[core][vec];
+#else
+    (void)core;
+    (void)vec;
+    return 0;
+#endif
+}
+
+void irq_stats_reset() {
+#ifdef IRQ_STATS
+    irq_stats_t *s = stats[this_cpu()->id];
+
+    for (uint32_t i = 0; i < IRQ_STATS_VECTORS; i++) {
+        s[i].count = 0;
+        s[i].cycles = 0;
+        s[i].max_cycles = 0;
+        s[i].max_latency = 0;
+    }
+#endif
+}
+
+void irq_stats_report() {
+#ifdef IRQ_STATS
+    const irq_stats_t *s;
+
+    for (uint32_t core = 0; core < NUM_CORES; core++) {
+        for (uint32_t vec = 0; vec < IRQ_STATS_VECTORS; vec++) {
+            s = &stats[core][vec];
+            if (!s->count) {
+                continue;
+            }
+            uart_puts("@irq core=");
+            uart_putu(core);
+            uart_puts(" vec=");
+            _put_vec(vec);
+            uart_puts(" count=");
+            uart_putu(s->count);
+            uart_puts(" cycles=");
+            uart_putu64(s->cycles);
+            uart_puts(" max=");
+            uart_putu(s->max_cycles);
+            uart_puts(" latency=");
+            uart_putu(s->max_latency);
+            uart_puts("\r\n");
+        }
+    }
+    uart_flush();
+#endif
+}
+
+#ifdef IRQ_STATS
+__time_critical void irq_stats_record(uint32_t vec, uint32_t start,
+                                      uint32_t latency) {
+    irq_stats_t *s = &stats[this_cpu()->id][vec];
+    uint32_t cycles = csr_read(mcycle) - start;
+
+    s->count++;
+    s->cycles += cycles;
+    if (cycles > s->max_cycles) {
+        s->max_cycles = cycles;
+    }
+    if (latency > s->max_latency) {
+        s->max_latency = latency;
+    }
+}
+
+__time_critical void irq_stats_mei(void *ctx, void (*fn)(void *),
+                                   uint32_t irq) {
+    uint32_t start = csr_read(mcycle);
+
+    fn(ctx);
+    irq_stats_record(IRQ_STATS_MEI + irq, start, 0);
+}
+
+__time_critical void irq_stats_exc(void *frame, void (*fn)(void *),
+                                   uint32_t cause) {
+    uint32_t start = csr_read(mcycle);
+
+    fn(frame);
+    irq_stats_record(IRQ_STATS_EXC + cause, start, 0);
+}
+
+static void _put_vec(uint32_t vec) {
+    if (vec == IRQ_STATS_MSI) {
+        uart_puts("msi");
+    } else if (vec == IRQ_STATS_MTI) {
+        uart_puts("mti");
+    } else if (vec >= IRQ_STATS_MEI) {
+        uart_puts("irq");
+        uart_putu(vec - IRQ_STATS_MEI);
+    } else {
+        uart_puts("exc");
+        uart_putu(vec - IRQ_STATS_EXC);
+    }
+}
+#endif
@@ -0,0 +1,87 @@
+/**
+ * @file irq_stats.h
+ * @brief Per-vector trap statistics: how often each handler runs, and for
+ *        how long.
+ *
+ * Building with IRQ_STATS=1 times every handler dispatched by isr_exc
+ * (__exception_table), isr_msi (work_msi), isr_mti (the timer service) and
+ * isr_mei (__external_interrupt_table), on each core. Cycles are inclusive
+ * of handlers that preempt them. Syscalls take the ecall fast path and are
+ * not counted.
+ *
+ * Latency is only known for isr_mti, as mtime ticks from the MTIMECMP
+ * deadline to the timer service. External interrupts carry no timestamp of
+ * when they became pending, so theirs stays 0.
+ *
+ * Without IRQ_STATS, the trap path is left exactly as it is, irq_stats
+ * returns 0 and irq_stats_report prints nothing.
+ *
+ * @author Herbie Rand
+ */
+
+#ifndef IRQ_STATS_H
+#define IRQ_STATS_H
+
+#include "rp2350.h"
+#include "types.h"
+
+/** @brief Vectors: exceptions by mcause, then msi, mti and IRQs by number */
+#define IRQ_STATS_EXC     0
+#define IRQ_STATS_MSI     12
+#define IRQ_STATS_MTI     13
+#define IRQ_STATS_MEI     14
+#define IRQ_STATS_VECTORS (IRQ_STATS_MEI + NUM_IRQS)
+
+typedef struct {
+    uint32_t count;
+    /** @brief mcycle in the handler, over all calls */
+    uint64_t cycles;
+    uint32_t max_cycles;
+    /** @brief Most mtime ticks a timer interrupt was taken late */
+    uint32_t max_latency;
+} irq_stats_t;
+
+/**
+ * @brief Returns a vector's statistics on a core, or 0 if built without
+ *        IRQ_STATS.
+ * @param core  Integer core number
+ * @param vec   Integer vector, see IRQ_STATS_EXC and the others
+ */
+const irq_stats_t *irq_stats(uint32_t core, uint32_t vec);
+
+/**
+ * @brief Clears the statistics of the calling core.
+ */
+void irq_stats_reset();
+
+/**
+ * @brief Prints one line per vector that ran on either core over the UART,
+ *        which must already be initialized:
+ *
+ *     @irq core=<n> vec=<exc3|msi|mti|irq46> count=<n> cycles=<total>
+ *          max=<cycles> latency=<ticks>
+ */
+void irq_stats_report();
+
+/**
+ * @brief Adds a call to a vector's statistics. Only built with IRQ_STATS,
+ *        like the two below.
+ * @param vec       Integer vector
+ * @param start     Integer mcycle when the handler was called
+ * @param latency   Integer mtime ticks the interrupt was late, or 0
+ */
+void irq_stats_record(uint32_t vec, uint32_t start, uint32_t latency);
+
+/**
+ * @brief Calls an external interrupt handler and records it, in place of
+ *        the direct call in isr_mei.
+ */
+void irq_stats_mei(void *ctx, void (*fn)(void *), uint32_t irq);
+
+/**
+ * @brief Calls an exception handler and records it, in place of the
+ *        direct call in isr_exc.
+ */
+void irq_stats_exc(void *frame, void (*fn)(void *), uint32_t cause);
+
+#endif
@@ -1,58 +1,198 @@
 #include "mtime.h"
 #include "asm.h"
 #include "clock.h"
+#include "riscv.h"
 #include "rp2350.h"
+#include "runtime.h"
+#include "section.h"
+#include "timer.h"
 #include "types.h"
 
-static mtime_cache_t cache;
+void isr_mtimer_irq();
+
+static void _mtimer_expire(void *arg);
+static uint64_t _mul(uint64_t x, uint32_t m);
+static uint64_t _mulhi(uint64_t x, uint32_t m);
+static uint64_t _div(uint64_t x, uint32_t d, uint32_t recip);
+
+/** @brief mtimer_start state of each core */
+static mtime_cache_t cache[NUM_CORES];
+static ktimer_t mtimer[NUM_CORES];
+
+/** @brief Fixed-point conversion factors, see `mtime_calibrate` */
+static struct {
+    /** @brief clk_sys cycles per microsecond */
+    uint32_t sys_mhz;
+    /** @brief 2^32 / sys_mhz, rounded down, see `_div` */
+    uint32_t sys_recip;
+} cal = {ROSC_NOMINAL_MHZ, MAX_UINT32 / ROSC_NOMINAL_MHZ};
 
 void mtimer_enable() {
     clr_mip(MTI_MASK);
+    timer_init();
     set_mie(MTI_MASK);
 }
 
 int mtimer_start(uint32_t us) {
-    uint32_t lo = 0;
-    uint32_t hi = 0;
-    uint32_t coef = clk_ref_freq_mhz();
+    uint32_t id = this_cpu()->id;
+    mtime_cache_t *c = &cache[id];
+    uint64_t ticks;
 
-    if (us == cache.us) {
-        lo = cache.mtimecmp;
-        hi = cache.mtimecmph;
+    if (us == c->us) {
+        ticks = ((uint64_t)c->mtimecmph << 32) | c->mtimecmp;
     } else {
-        // safe 32-bit * 32-bit multiplication
-        // note that exceeding 64 bits is impossible
-        while (coef--) {
-            if (lo + us < lo) {
-                hi++;
-            }
-            lo += us;
-        }
-        cache.us = us;
-        cache.mtimecmp = lo;
-        cache.mtimecmph = hi;
+        ticks = us_to_ticks(us);
+        c->us = us;
+        c->mtimecmp = (uint32_t)ticks;
+        c->mtimecmph = (uint32_t)(ticks >> 32);
     }
 
-    AT(SIO_MTIME_CTRL) = 0;
-    AT(SIO_MTIME) = 0;
-    AT(SIO_MTIMEH) = 0;
-    AT(SIO_MTIMECMP) = (uint32_t)-1;
-    AT(SIO_MTIMECMPH) = hi;
-    AT(SIO_MTIMECMP) = lo;
-    AT(SIO_MTIME_CTRL) = 3;
+    // mtime is free-running, so the deadline is relative to now
+    timer_start(&mtimer[id], mtime_read() + ticks, _mtimer_expire, 0);
     return 0;
 }
 
-#include "clock.h"
+__time_critical uint64_t mtime_read() {
+    uint32_t hi;
+    uint32_t lo;
 
-// Some tests indicate that each loop takes ~5 cycles.
-// Either that, or I have misconfigured something else.
-// But the frequency counter indicates that the clock
-// sources are configured correctly.
-// See test/test_clk_frequency for details.
-void spin_us(uint32_t us) {
-    uint32_t mhz = clk_sys_freq_mhz();
-    uint32_t spin = (mhz * us) / 5;
-    while (spin--)
+    // re-read if the low half carried into the high half in between
+    do {
+        hi = AT(SIO_MTIMEH);
+        lo = AT(SIO_MTIME);
+    } while (hi != AT(SIO_MTIMEH));
+
+    return ((uint64_t)hi << 32) | lo;
+}
+
+__time_critical void mtimer_set(uint64_t deadline) {
+    // write the low half to all ones first, so no spurious interrupt fires
+    // while the high half is updated
+    AT(SIO_MTIMECMP) = (uint32_t)-1;
+    AT(SIO_MTIMECMPH) = (uint32_t)(deadline >> 32);
+    AT(SIO_MTIMECMP) = (uint32_t)deadline;
+}
+
+void mtime_calibrate() {
+    uint32_t ref = clk_ref_freq_mhz();
+    uint32_t sys = clk_sys_freq_mhz();
+
+    if (!ref) {
+        ref = ROSC_NOMINAL_MHZ;
+    }
+    if (!sys) {
+        sys = ROSC_NOMINAL_MHZ;
+    }
+
+#ifndef BOARD_QEMU_VIRT
+    // the tick generator must be stopped to change its divider
+    AT(TICKS_RISCV_CTRL) = 0;
+    AT(TICKS_RISCV_CYCLES) = ref / MTIME_TICKS_PER_US;
+    AT(TICKS_RISCV_CTRL) = TICKS_CTRL_ENABLE;
+#endif
+
+    cal.sys_mhz = sys;
+    cal.sys_recip = MAX_UINT32 / sys;
+}
+
+uint64_t mcycle_read() {
+    uint32_t hi;
+    uint32_t lo;
+
+    do {
+        hi = csr_read(mcycleh);
+        lo = csr_read(mcycle);
+    } while (hi != csr_read(mcycleh));
+
+    return ((uint64_t)hi << 32) | lo;
+}
+
+uint64_t us_to_ticks(uint64_t us) {
+    return us * MTIME_TICKS_PER_US;
+}
+
+uint64_t ticks_to_us(uint64_t ticks) {
+#if MTIME_TICKS_PER_US & (MTIME_TICKS_PER_US - 1)
+    // not a shift, so multiply by the reciprocal rather than call libgcc
+    return _div(ticks, MTIME_TICKS_PER_US, MAX_UINT32 / MTIME_TICKS_PER_US);
+#else
+    return ticks / MTIME_TICKS_PER_US;
+#endif
+}
+
+uint64_t us_to_cycles(uint64_t us) {
+    return _mul(us, cal.sys_mhz);
+}
+
+uint64_t cycles_to_us(uint64_t cycles) {
+    return _div(cycles, cal.sys_mhz, cal.sys_recip);
+}
+
+uint64_t ticks_to_cycles(uint64_t ticks) {
+    return us_to_cycles(ticks_to_us(ticks));
+}
+
+uint64_t cycles_to_ticks(uint64_t cycles) {
+    return us_to_ticks(cycles_to_us(cycles));
+}
+
+void spin_cycles(uint32_t cycles) {
+    uint32_t start = csr_read(mcycle);
+
+    // unsigned difference, so mcycle wrapping around is harmless
+    while (csr_read(mcycle) - start < cycles)
         ;
 }
+
+void spin_ticks(uint64_t ticks) {
+    uint64_t end = mtime_read() + ticks;
+
+    while (mtime_read() < end)
+        ;
+}
+
+void spin_us(uint32_t us) {
+    uint64_t cycles = us_to_cycles(us);
+
+    if (cycles <= MAX_UINT32) {
+        spin_cycles((uint32_t)cycles);
+    } else {
+        spin_ticks(us_to_ticks(us));
+    }
+}
+
+static void _mtimer_expire(void *arg) {
+    (void)arg;
+    isr_mtimer_irq();
+}
+
+// x * m, truncated to 64 bits. Built from 32x32->64 multiplies only, which
+// avoids a libgcc call.
+static uint64_t _mul(uint64_t x, uint32_t m) {
+    uint32_t lo = (uint32_t)x;
+    uint32_t hi = (uint32_t)(x >> 32);
+
+    return (uint64_t)lo * m + ((uint64_t)(hi * m) << 32);
+}
+
+// (x * m) >> 32, i.e. x times the 0.32 fixed-point fraction m
+static uint64_t _mulhi(uint64_t x, uint32_t m) {
+    uint32_t lo = (uint32_t)x;
+    uint32_t hi = (uint32_t)(x >> 32);
+
+    return (uint64_t)hi * m + (((uint64_t)lo * m) >> 32);
+}
+
+// x / d, rounded down, from recip = (2^32 - 1) / d and no 64-bit division.
+// The rounded-down reciprocal never over-estimates a quotient, so each step
+// adds the quotient of the remainder the one before left: the first leaves
+// under (d + 1) * (x / 2^32 + 3), the second under d * (d + 5), which a
+// 32-bit division finishes for any d below 2^15.
+static uint64_t _div(uint64_t x, uint32_t d, uint32_t recip) {
+    uint64_t q = _mulhi(x, recip);
+    uint64_t r = x - _mul(q, d);
+    uint64_t q2 = _mulhi(r, recip);
+
+    r -= _mul(q2, d);
+    return q + q2 + (uint32_t)r / d;
+}
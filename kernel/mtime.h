@@ -2,13 +2,14 @@
 #define MTIME_H
 
 #include "rp2350.h"
+#include "timebase.h"
 #include "types.h"
 
 /**
  * @brief Cache structure to prevent re-computing mtimecmph.
  *
  * May be helpful in case mtimecmph computations are expensive,
- * and/or the mtime counter is frequently reset.
+ * e.g. for a timer re-armed with the same duration every time.
  */
 typedef struct {
     /** @brief Milliseconds (cache key) */
@@ -20,24 +21,81 @@ typedef struct {
 } mtime_cache_t;
 
 /**
- * @brief Enables the mtime timer interrupt.
+ * @brief Enables the mtime timer interrupt and the timer service.
  * You can implement the interrupt handler by overriding
  * the weak definition for `void isr_mtimer_irq()`.
  */
 void mtimer_enable();
 
 /**
- * @brief Starts the RISC-V mtime timer, interrupting at the provided duration.
+ * @brief Arms a one-shot timer that calls `isr_mtimer_irq` after the
+ *        provided duration. mtime itself keeps running.
  * @param us    Integer microseconds indicating duration before interrupt.
  * @return 0 on success, nonzero on error
  */
 int mtimer_start(uint32_t us);
 
+/**
+ * @brief Reads the free-running 64-bit mtime counter.
+ * @returns Integer mtime
+ */
+uint64_t mtime_read();
+
+/**
+ * @brief Programs this core's MTIMECMP with an absolute deadline.
+ * @param deadline  Integer absolute mtime value
+ */
+void mtimer_set(uint64_t deadline);
+
 /**
  * @brief Stops the mtime timer from ticking.
  */
 // void mtimer_stop();
 
+/**
+ * @brief Re-derives the mtime divider and conversion factors from
+ *        `clk_ref_freq_mhz` and `clk_sys_freq_mhz`.
+ * Called by `clock_defaults_set`; call it after any other change to
+ * clk_ref or clk_sys. Unknown (zero) frequencies count as the ROSC nominal.
+ */
+void mtime_calibrate();
+
+/**
+ * @brief Reads this core's free-running 64-bit mcycle counter.
+ * @returns Integer clk_sys cycles since reset
+ */
+uint64_t mcycle_read();
+
+/**
+ * Conversions between microseconds, mtime ticks and clk_sys cycles.
+ * Each is a handful of multiplies by a precomputed fixed-point factor, so
+ * the cost does not depend on the value. Conversions to coarser units round
+ * down, exactly.
+ */
+uint64_t us_to_ticks(uint64_t us);
+uint64_t ticks_to_us(uint64_t ticks);
+uint64_t us_to_cycles(uint64_t us);
+uint64_t cycles_to_us(uint64_t cycles);
+uint64_t ticks_to_cycles(uint64_t ticks);
+uint64_t cycles_to_ticks(uint64_t cycles);
+
+/**
+ * @brief Busy-waits for a number of clk_sys cycles, read from mcycle.
+ * @param cycles    Integer clk_sys cycles
+ */
+void spin_cycles(uint32_t cycles);
+
+/**
+ * @brief Busy-waits for a number of mtime ticks.
+ * @param ticks     Integer mtime ticks
+ */
+void spin_ticks(uint64_t ticks);
+
+/**
+ * @brief Busy-waits for a number of microseconds. Counts cycles where they
+ *        fit in 32 bits, and mtime ticks beyond that.
+ * @param us    Integer microseconds
+ */
 void spin_us(uint32_t us);
 
 #endif
@@ -0,0 +1,163 @@
+/**
+ * @file pool.c
+ * @brief Implements fixed-size block pools, see pool.h.
+ * @author Herbie Rand
+ */
+
+#include "pool.h"
+#include "asm.h"
+#include "atomic.h"
+#include "runtime.h"
+#include "types.h"
+
+#define INDEX_MASK 0xffff
+#define TAG_ONE    0x10000
+
+static void _refill(pool_t *p, pool_cpu_t *c);
+static void _spill(pool_t *p, pool_cpu_t *c, void *b);
+static void *_pop(pool_t *p);
+static void _push(pool_t *p, void **blocks, uint32_t n);
+
+static __inline void *_block(const pool_t *p, uint32_t i) {
+    return p->storage + i * p->block_words;
+}
+
+static __inline uint32_t _index(const pool_t *p, void *b) {
+    return ((uint32_t *)b - p->storage) / p->block_words;
+}
+
+void *pool_alloc(pool_t *p) {
+    uint32_t mie = irq_save();
+    pool_cpu_t *c = &p->cpu[this_cpu()->id];
+    void *b = 0;
+
+    if (!c->count) {
+        _refill(p, c);
+    }
+    if (c->count) {
+        b = c->blocks[--c->count];
+        c->allocs++;
+    } else {
+        c->failures++;
+    }
+    irq_restore(mie);
+    return b;
+}
+
+void pool_free(pool_t *p, void *b) {
+    uint32_t mie;
+    uint32_t off;
+    pool_cpu_t *c;
+
+    if (!b) {
+        return;
+    }
+    off = (uint32_t *)b - p->storage;
+    if ((uint32_t *)b < p->storage || off >= p->block_words * p->nblocks ||
+        off % p->block_words) {
+        breakpoint();
+        return;
+    }
+
+    mie = irq_save();
+    c = &p->cpu[this_cpu()->id];
+    if (c->count == p->cache_size) {
+        _spill(p, c, b);
+    } else {
+        c->blocks[c->count++] = b;
+    }
+    c->frees++;
+    irq_restore(mie);
+}
+
+void pool_stats(const pool_t *p, pool_stats_t *out) {
+    out->size = p->block_words * 4;
+    out->nblocks = p->nblocks;
+    out->high_water = atomic_u32_load(&p->carved);
+    out->allocs = 0;
+    out->frees = 0;
+    out->failures = 0;
+    for (uint32_t i = 0; i < NUM_CORES; i++) {
+        out->allocs += p->cpu[i].allocs;
+        out->frees += p->cpu[i].frees;
+        out->failures += p->cpu[i].failures;
+    }
+    out->in_use = out->allocs - out->frees;
+}
+
+// Takes up to half a cache of blocks from the shared list, or else carves
+// a single new one, so the high-water mark only grows when it must. An
+// uncached pool takes the one block pool_alloc hands out right away.
+static void _refill(pool_t *p, pool_cpu_t *c) {
+    uint32_t want = p->cache_size ? p->cache_size / 2 : 1;
+    uint32_t n;
+    void *b;
+
+    while (c->count < want && (b = _pop(p))) {
+        c->blocks[c->count++] = b;
+    }
+    if (c->count) {
+        return;
+    }
+
+    n = atomic_u32_load(&p->carved);
+    do {
+        if (n >= p->nblocks) {
+            return;
+        }
+    } while (!atomic_u32_cas(&p->carved, &n, n + 1));
+    c->blocks[c->count++] = _block(p, n);
+}
+
+// Gives the least recently freed half of a full cache back to the shared
+// list, keeping the blocks most likely still in this core's cache lines,
+// then caches b. An uncached pool gives b back instead.
+static void _spill(pool_t *p, pool_cpu_t *c, void *b) {
+    uint32_t n = p->cache_size / 2;
+
+    if (!n) {
+        _push(p, &b, 1);
+        return;
+    }
+    _push(p, c->blocks, n);
+    for (uint32_t i = n; i < c->count; i++) {
+        c->blocks[i - n] = c->blocks[i];
+    }
+    c->count -= n;
+    c->blocks[c->count++] = b;
+}
+
+static void *_pop(pool_t *p) {
+    uint32_t old;
+    uint32_t next;
+    void *b;
+
+    do {
+        // load with acquire, so the link read below is the pusher's
+        old = atomic_u32_load(&p->head);
+        if (!(old & INDEX_MASK)) {
+            return 0;
+        }
+        b = _block(p, (old & INDEX_MASK) - 1);
+        // stale if another core popped b meanwhile, then the tag has
+        // changed and the swap fails
+        next = *(volatile uint32_t *)b & INDEX_MASK;
+    } while (!atomic_u32_cas(&p->head, &old,
+                             ((old + TAG_ONE) & ~INDEX_MASK) | next));
+    return b;
+}
+
+// Pushes n blocks as one chain, so a spill costs a single swap
+static void _push(pool_t *p, void **blocks, uint32_t n) {
+    uint32_t old = atomic_u32_load(&p->head);
+    uint32_t first = _index(p, blocks[0]) + 1;
+    volatile uint32_t *last = blocks[n - 1];
+
+    for (uint32_t i = 0; i + 1 < n; i++) {
+        *(uint32_t *)blocks[i] = _index(p, blocks[i + 1]) + 1;
+    }
+    do {
+        *last = old & INDEX_MASK;
+    } while (!atomic_u32_cas(&p->head, &old,
+                             ((old + TAG_ONE) & ~INDEX_MASK) | first));
+}
@@ -0,0 +1,139 @@
+/**
+ * @file pool.h
+ * @brief Fixed-size block pools for kernel objects.
+ *
+ * Each pool hands out blocks of a single type, from static storage sized at
+ * build time with POOL_DEFINE. pool_alloc and pool_free take constant time
+ * and cannot fragment. Both may be called from tasks, ISRs and either core.
+ *
+ * Each core keeps a small cache of free blocks, which it only touches with
+ * interrupts off, so the common case is a few loads and stores without any
+ * atomics. An empty cache is refilled from the pool's shared free list, and
+ * a full one spills half of its blocks back there. The other core cannot
+ * reach into a cache, so the caches of all cores together hold at most half
+ * of the pool, see POOL_CACHE_LIMIT: an allocation fails only once at least
+ * half of the blocks are in use. Pools of fewer than 4 * NUM_CORES blocks
+ * are not cached at all, and fail only when every block is in use.
+ *
+ * The shared list is a lock-free stack linked by block index. Its head also
+ * holds a tag that changes on every update, so a compare-and-swap cannot
+ * succeed on a stale head (ABA) unless exactly 65536 updates happened in
+ * between.
+ *
+ * Blocks are carved from the storage only when neither list has one, so a
+ * pool needs no initialization. The number carved is its high-water mark,
+ * which counts blocks parked in core caches as well as those in use: it is
+ * an upper bound on the peak of in_use, not the peak itself.
+ *
+ * NOTE: storage must be in SRAM, see atomic.h.
+ *
+ * @author Herbie Rand
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include "atomic.h"
+#include "runtime.h"
+#include "types.h"
+
+/** @brief Most free blocks each core may keep, even */
+#define POOL_CACHE_SIZE 8
+/** @brief Most blocks in a pool, limited by the 16-bit block index */
+#define POOL_MAX_BLOCKS 0xffff
+
+/**
+ * @brief Free blocks each core may keep in a pool of n: even, at most
+ *        POOL_CACHE_SIZE, and n / (2 * NUM_CORES) rounded down, so the
+ *        caches never hold more than half of the pool.
+ */
+#define POOL_CACHE_LIMIT(n)                                                    \
+    ((n) / (4 * NUM_CORES) * 2 < POOL_CACHE_SIZE ? (n) / (4 * NUM_CORES) * 2  \
+                                                 : POOL_CACHE_SIZE)
+
+/** @brief Words per block of type, a multiple of 8 bytes */
+#define POOL_BLOCK_WORDS(type) (((sizeof(type) + 7) / 8) * 2)
+
+/**
+ * @brief Defines pool_t name, with storage for n blocks of type.
+ * @param name  Pool variable name
+ * @param type  Type of the blocks
+ * @param n     Integer number of blocks, up to POOL_MAX_BLOCKS
+ */
+#define POOL_DEFINE(name, type, n)                                             \
+    static uint32_t name##_storage[POOL_BLOCK_WORDS(type) * (n)]              \
+        __attribute__((aligned(8)));                                           \
+    pool_t name = {#name, name##_storage, POOL_BLOCK_WORDS(type), (n),        \
+                   POOL_CACHE_LIMIT(n)}
+
+/**
+ * @brief Allocates a block from a pool defined for type.
+ * @returns Pointer to type, or 0 if the pool is exhausted
+ */
+#define POOL_NEW(pool, type) ((type *)pool_alloc(&(pool)))
+
+/** @brief Per-core cache and counters, see pool.h */
+typedef struct {
+    /** @brief Free blocks, the most recently freed last */
+    void *blocks[POOL_CACHE_SIZE];
+    uint32_t count;
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t failures;
+} pool_cpu_t;
+
+typedef struct {
+    const char *name;
+    uint32_t *storage;
+    uint32_t block_words;
+    uint32_t nblocks;
+    /** @brief Free blocks each core may keep, see POOL_CACHE_LIMIT */
+    uint32_t cache_size;
+    /** @brief Shared free list, (tag << 16) | (index + 1), 0 when empty */
+    atomic_u32_t head;
+    /** @brief Blocks carved from storage so far */
+    atomic_u32_t carved;
+    pool_cpu_t cpu[NUM_CORES];
+} pool_t;
+
+typedef struct {
+    /** @brief Block size in bytes */
+    uint32_t size;
+    uint32_t nblocks;
+    /** @brief Blocks allocated and not yet freed */
+    uint32_t in_use;
+    /**
+     * @brief Blocks carved from storage: the peak of in_use plus blocks
+     *        parked in core caches, see pool.h
+     */
+    uint32_t high_water;
+    uint32_t allocs;
+    uint32_t frees;
+    /** @brief Allocations that found the pool exhausted */
+    uint32_t failures;
+} pool_stats_t;
+
+/**
+ * @brief Allocates a block. O(1), safe from ISRs and either core.
+ * @param p     Pool
+ * @returns Pointer to the block, or 0 if the pool is exhausted
+ */
+void *pool_alloc(pool_t *p);
+
+/**
+ * @brief Returns a block to its pool. O(1), safe from ISRs and either core.
+ * Hits a breakpoint if b is not a block of p.
+ * @param p     Pool b was allocated from
+ * @param b     Block, or 0 to do nothing
+ */
+void pool_free(pool_t *p, void *b);
+
+/**
+ * @brief Sums the statistics of all cores. Counters of the other core may
+ *        be mid-update, so the result is approximate while it runs.
+ * @param p     Pool
+ * @param out   Filled in with the statistics
+ */
+void pool_stats(const pool_t *p, pool_stats_t *out);
+
+#endif
@@ -0,0 +1,145 @@
+/**
+ * @file qemu_virt.h
+ * @brief Platform layer for the QEMU riscv32 `virt` machine, built with
+ *        `make BOARD=qemu-virt` (BOARD_QEMU_VIRT).
+ *
+ * Included at the end of rp2350.h, it points the RP2350 registers that the
+ * portable kernel relies on at their virt counterparts:
+ *
+ * - SIO mtime and MTIMECMP: the CLINT, which ticks at a fixed 10 MHz
+ * - RISCV_SOFTIRQ: the CLINT MSIP words, see softirq_set
+ * - external interrupts: the PLIC, claimed by isr_mei (startup.S)
+ * - UART0: the NS16550A, driven by kernel/qemu_virt/uart.c
+ *
+ * Clocks, resets and GPIO have no counterpart and are stubbed out in
+ * kernel/qemu_virt. The Hazard3 CSRs (MEIEA, MEIFA, MEINEXT, MEICONTEXT),
+ * the SIO FIFOs and hardware spinlocks, DMA and the XIP cache do not exist;
+ * spinlock_init hands out ticket locks only.
+ *
+ * Without a debugger, breakpoint() stops QEMU, see isr_inst_ebreak_exc in
+ * kernel/qemu_virt/platform.c.
+ *
+ * @see QEMU hw/riscv/virt.c for the memory map
+ * @author Herbie Rand
+ */
+
+#ifndef QEMU_VIRT_H
+#define QEMU_VIRT_H
+
+// SiFive test device, a write ends the simulation
+#define VIRT_TEST      0x00100000
+#define VIRT_TEST_FAIL 0x3333 // exit status in bits 31:16
+#define VIRT_TEST_PASS 0x5555
+
+// QEMUFLAGS run one instruction every 8 ns (-icount shift=3), so mcycle
+// counts instructions at a nominal 125 MHz
+#define VIRT_CLK_SYS_MHZ 125
+#define VIRT_CLK_REF_MHZ 10
+
+// One MSIP word and one 64-bit MTIMECMP per hart, one shared mtime
+#define CLINT_BASE     0x02000000
+#define CLINT_MSIP     0x02000000
+#define CLINT_MTIMECMP 0x02004000
+#define CLINT_MTIME    0x0200bff8
+
+// Hart n takes M-mode interrupts through PLIC context 2n
+#define PLIC_BASE                 0x0c000000
+#define PLIC_PRIORITY             0x0c000000
+#define PLIC_ENABLE               0x0c002000
+#define PLIC_THRESHOLD            0x0c200000
+#define PLIC_CLAIM                0x0c200004
+#define PLIC_HART_ENABLE_STRIDE   0x100
+#define PLIC_HART_CONTEXT_STRIDE  0x2000
+#define PLIC_PRIORITY_MAX         7
+
+#define VIRT_UART0 0x10000000
+
+// NS16550A registers, byte wide
+#define UART_RBR 0x10000000 // read, DLAB = 0
+#define UART_THR 0x10000000 // write, DLAB = 0
+#define UART_IER 0x10000001
+#define UART_IIR 0x10000002 // read
+#define UART_FCR 0x10000002 // write
+#define UART_LCR 0x10000003
+#define UART_MCR 0x10000004
+#define UART_LSR 0x10000005
+
+// Flags for UART_IER
+#define UART_IER_RDI  0x1 // RX data available or timeout
+#define UART_IER_THRI 0x2 // THR empty
+
+// Flags for UART_IIR
+#define UART_IIR_NO_INT 0x1
+
+// Flags for UART_FCR, the trigger level is in bits 7:6
+#define UART_FCR_ENABLE     0x1
+#define UART_FCR_CLEAR_RX   0x2
+#define UART_FCR_CLEAR_TX   0x4
+#define UART_FCR_TRIG_SHIFT 6
+
+// Flags for UART_LCR
+#define UART_LCR_8N1 0x03
+#define UART_LCR_DLAB 0x80 // divisor latch in place of RBR/THR and IER
+
+// Flags for UART_MCR, OUT2 gates the interrupt output
+#define UART_MCR_OUT2 0x8
+
+// Flags for UART_LSR
+#define UART_LSR_DR   0x01
+#define UART_LSR_OE   0x02
+#define UART_LSR_PE   0x04
+#define UART_LSR_FE   0x08
+#define UART_LSR_THRE 0x20
+#define UART_LSR_TEMT 0x40
+
+#define UART_LSR_ERR_MASK (UART_LSR_OE | UART_LSR_PE | UART_LSR_FE)
+
+// IRQ numbers, for irq_enable and __external_interrupt_table
+#undef UART0_IRQ
+#define UART0_IRQ 10
+
+#undef SIO_MTIME
+#undef SIO_MTIMEH
+#undef SIO_MTIMECMP
+#undef SIO_MTIMECMPH
+#define SIO_MTIME  CLINT_MTIME
+#define SIO_MTIMEH (CLINT_MTIME + 4)
+
+#ifndef __ASSEMBLER__
+
+#include "types.h"
+
+static __inline uint32_t _virt_hartid() {
+    uint32_t id;
+    asm volatile("csrr %0, mhartid" : "=r"(id));
+    return id;
+}
+
+// each hart has its own MTIMECMP, at the same address on the RP2350
+#define SIO_MTIMECMP  (CLINT_MTIMECMP + 8 * _virt_hartid())
+#define SIO_MTIMECMPH (SIO_MTIMECMP + 4)
+
+// threshold register of this hart's M-mode PLIC context
+#define PLIC_HART_THRESHOLD                                                    \
+    (PLIC_THRESHOLD + PLIC_HART_CONTEXT_STRIDE * _virt_hartid())
+
+/**
+ * @brief Folds a Hazard3 priority, 0 to 15, onto the PLIC's levels. 0 never
+ *        interrupts on the PLIC, so they start at 1.
+ * @param prio  Integer priority, see irq_set_priority
+ * @returns Integer PLIC priority, 1 to PLIC_PRIORITY_MAX
+ */
+static __inline uint32_t plic_priority(uint32_t prio) {
+    prio = 1 + (prio >> 1);
+    return prio < PLIC_PRIORITY_MAX ? prio : PLIC_PRIORITY_MAX;
+}
+
+/**
+ * @brief Stops QEMU through the test device.
+ * @param status    Integer exit status of qemu-system-riscv32
+ */
+void virt_exit(uint32_t status);
+
+#endif
+
+#endif
@@ -0,0 +1,74 @@
+/**
+ * @file clock.c
+ * @brief clock.h for the virt machine, which has no clock tree to set up.
+ *
+ * The frequencies reported are the nominal ones QEMUFLAGS give the guest,
+ * see VIRT_CLK_SYS_MHZ in qemu_virt.h.
+ *
+ * @author Herbie Rand
+ */
+
+#include "clock.h"
+#include "mtime.h"
+#include "rp2350.h"
+#include "types.h"
+
+static uint32_t _clk_sys_freq_mhz = 0;
+static uint32_t _clk_ref_freq_mhz = 0;
+
+void clock_defaults_set() {
+    _clk_ref_freq_mhz = VIRT_CLK_REF_MHZ;
+    _clk_sys_freq_mhz = VIRT_CLK_SYS_MHZ;
+    mtime_calibrate();
+}
+
+uint32_t clk_sys_freq_mhz() {
+    return _clk_sys_freq_mhz;
+}
+
+uint32_t clk_ref_freq_mhz() {
+    return _clk_ref_freq_mhz;
+}
+
+void clk_sys_config(uint32_t src, uint32_t auxsrc, uint32_t div) {
+    (void)src, (void)auxsrc, (void)div;
+}
+
+void clk_ref_config(uint32_t src, uint32_t auxsrc, uint32_t div) {
+    (void)src, (void)auxsrc, (void)div;
+}
+
+void clk_usb_config(uint32_t auxsrc, uint32_t div) {
+    (void)auxsrc, (void)div;
+}
+
+void clk_peri_config(uint32_t auxsrc, uint32_t div) {
+    (void)auxsrc, (void)div;
+}
+
+void clk_adc_config(uint32_t auxsrc, uint32_t div) {
+    (void)auxsrc, (void)div;
+}
+
+void clk_hstx_config(uint32_t auxsrc, uint32_t div) {
+    (void)auxsrc, (void)div;
+}
+
+void xosc_init() {
+}
+
+void xosc_start() {
+}
+
+void xosc_wait() {
+}
+
+void pll_sys_init(uint32_t refdiv, uint32_t vcofreq, uint32_t postdiv1,
+                  uint32_t postdiv2) {
+    (void)refdiv, (void)vcofreq, (void)postdiv1, (void)postdiv2;
+}
+
+void pll_usb_init(uint32_t refdiv, uint32_t vcofreq, uint32_t postdiv1,
+                  uint32_t postdiv2) {
+    (void)refdiv, (void)vcofreq, (void)postdiv1, (void)postdiv2;
+}
@@ -0,0 +1,33 @@
+/**
+ * @file gpio.c
+ * @brief gpio.h for the virt machine, which has no GPIO. Output levels are
+ *        kept in gpio_out, so blinky-style programs can be inspected from
+ *        the debugger.
+ * @author Herbie Rand
+ */
+
+#include "gpio.h"
+#include "types.h"
+
+/** @brief Level of each pin, bit n for pin n */
+volatile uint32_t gpio_out;
+
+void gpio_init(uint32_t pin) {
+    gpio_out &= ~(1UL << pin);
+}
+
+void gpio_init_func(uint32_t pin, uint32_t funcsel) {
+    (void)pin, (void)funcsel;
+}
+
+void gpio_set(uint32_t pin) {
+    gpio_out |= 1UL << pin;
+}
+
+void gpio_clr(uint32_t pin) {
+    gpio_out &= ~(1UL << pin);
+}
+
+void gpio_set_func(uint32_t pin, uint32_t fn) {
+    (void)pin, (void)fn;
+}
@@ -0,0 +1,96 @@
+/**
+ * @file platform.c
+ * @brief Boot and debug glue of the virt machine: starting core 1, and
+ *        what breakpoint() does without a debugger.
+ * @author Herbie Rand
+ */
+
+#include "asm.h"
+#include "riscv.h"
+#include "rp2350.h"
+#include "runtime.h"
+#include "types.h"
+
+/**
+ * @brief mtvec, sp and pc for core 1, which waits for them in _core1_park
+ *        (startup.S). pc is written last.
+ */
+volatile uint32_t core1_boot[3];
+
+/**
+ * @brief Nonzero to resume after a breakpoint, rather than stop QEMU. Set
+ *        by util/gdb_qemu_virt_template.
+ */
+volatile uint32_t qemu_break_resume;
+
+static void _puts(const char *s);
+static void _puthex(uint32_t v);
+
+void init_core1(uint32_t vt, uint32_t sp, uint32_t pc) {
+    core1_boot[0] = vt | 0x1; // enable vectored mode
+    core1_boot[1] = sp;
+    __atomic_store_n(&core1_boot[2], pc, __ATOMIC_RELEASE);
+    softirq_raise(1);
+}
+
+void virt_exit(uint32_t status) {
+    AT(VIRT_TEST) = status ? (status << 16) | VIRT_TEST_FAIL : VIRT_TEST_PASS;
+    while (1)
+        ;
+}
+
+/**
+ * @brief Failed check in a test, overrides the weak definition in asm.S.
+ * Reports where it was called from on the console, then stops QEMU with
+ * a failing exit status, unless qemu_break_resume is set, in which case it
+ * is a breakpoint as usual.
+ */
+void test_fail() {
+    if (qemu_break_resume) {
+        breakpoint();
+        return;
+    }
+    _puts("@fail pc=0x");
+    _puthex((uint32_t)__builtin_return_address(0));
+    _puts("\r\n");
+    virt_exit(1);
+}
+
+/**
+ * @brief Breakpoint handler, overrides the weak definition in startup.S.
+ * QEMU traps ebreak like any exception, debugger or not. Reports where it
+ * was hit on the console, then stops QEMU with exit status 0, unless
+ * qemu_break_resume is set.
+ */
+void isr_inst_ebreak_exc(void *frame) {
+    uint32_t pc = csr_read(mepc);
+
+    (void)frame;
+    _puts("@break pc=0x");
+    _puthex(pc);
+    _puts("\r\n");
+    if (!qemu_break_resume) {
+        virt_exit(0);
+    }
+    // skip the ebreak, which may be compressed
+    csr_write(mepc, pc + ((*(uint16_t *)pc & 0x3) == 0x3 ? 4 : 2));
+}
+
+// Polled, in case the UART driver is in interrupt-driven mode
+static void _puts(const char *s) {
+    while (*s) {
+        while (!(*(volatile uint8_t *)UART_LSR & UART_LSR_THRE))
+            ;
+        *(volatile uint8_t *)UART_THR = *s++;
+    }
+}
+
+static void _puthex(uint32_t v) {
+    char buf[9];
+
+    for (uint32_t i = 0; i < 8; i++) {
+        buf[i] = "0123456789abcdef"[(v >> (28 - 4 * i)) & 0xf];
+    }
+    buf[8] = 0;
+    _puts(buf);
+}
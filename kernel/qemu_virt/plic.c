@@ -0,0 +1,55 @@
+/**
+ * @file plic.c
+ * @brief asm.h interrupt helpers for the virt machine, over the PLIC
+ *        instead of the Hazard3 MEIEA and MEIFA CSRs.
+ *
+ * Each core enables IRQs in its own M-mode PLIC context, as each Hazard3
+ * core has its own MEIEA. isr_mei (startup.S) claims and completes them.
+ *
+ * @author Herbie Rand
+ */
+
+#include "asm.h"
+#include "riscv.h"
+#include "rp2350.h"
+#include "types.h"
+
+static __inline uint32_t _enable_reg(uint32_t irq) {
+    return PLIC_ENABLE + PLIC_HART_ENABLE_STRIDE * csr_read(mhartid) +
+           4 * (irq >> 5);
+}
+
+void irq_enable(uint32_t irq) {
+    uint32_t mie = irq_save();
+
+    // priority 0 never interrupts, give unconfigured IRQs the lowest other
+    if (!AT(PLIC_PRIORITY + 4 * irq)) {
+        AT(PLIC_PRIORITY + 4 * irq) = 1;
+    }
+    AT(_enable_reg(irq)) |= 1UL << (irq & 0x1f);
+    irq_restore(mie);
+}
+
+void irq_disable(uint32_t irq) {
+    uint32_t mie = irq_save();
+
+    AT(_enable_reg(irq)) &= ~(1UL << (irq & 0x1f));
+    irq_restore(mie);
+}
+
+void irq_set_priority(uint32_t irq, uint32_t prio) {
+    AT(PLIC_PRIORITY + 4 * irq) = plic_priority(prio);
+}
+
+void irq_force(uint32_t irq) {
+    // the PLIC only takes interrupts from devices
+    (void)irq;
+    breakpoint();
+}
+
+void irq_unforce(uint32_t irq) {
+    (void)irq;
+}
+
+void clr_meifa() {
+}
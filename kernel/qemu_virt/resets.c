@@ -0,0 +1,25 @@
+/**
+ * @file resets.c
+ * @brief resets.h for the virt machine, whose devices need no reset cycle.
+ * @author Herbie Rand
+ */
+
+#include "resets.h"
+
+void initial_reset_cycle() {
+}
+
+void postclk_reset_cycle() {
+}
+
+void pll_sys_reset_cycle() {
+}
+
+void pll_usb_reset_cycle() {
+}
+
+void pll_reset_cycle() {
+}
+
+void uart_reset_cycle() {
+}
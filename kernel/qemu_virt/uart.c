@@ -0,0 +1,253 @@
+/**
+ * @file uart.c
+ * @brief uart.h for the virt machine's NS16550A, which QEMU connects to
+ *        the console (-serial stdio in QEMUFLAGS).
+ *
+ * Same model as the PL011 driver in kernel/uart.c: polled until
+ * `uart_irq_enable`, then interrupt-driven through the TX and RX rings. The
+ * 16550 raises its TX interrupt when the FIFO is empty, so txlevel has no
+ * effect, and there is no DMA.
+ *
+ * @author Herbie Rand
+ */
+
+#include "uart.h"
+#include "asm.h"
+#include "riscv.h"
+#include "rp2350.h"
+#include "spinlock.h"
+
+#define BAUDRATE 115200
+// nominal, QEMU does not pace the line
+#define UART_CLOCK_HZ 3686400
+#define UART_FIFO_SIZE 16
+
+#define TX_MASK (UART_TX_BUFSIZE - 1)
+#define RX_MASK (UART_RX_BUFSIZE - 1)
+
+// 16550 registers are one byte wide, a word store would spill into the next
+#define AT8(addr) (*(volatile uint8_t *)(addr))
+
+static void _putc(char c);
+static char _getc();
+static void _tx_fill();
+static void _rx_drain();
+static void _idle(uint32_t mie);
+
+/**
+ * @brief Rings for interrupt-driven mode, see kernel/uart.c.
+ */
+static struct {
+    char tx[UART_TX_BUFSIZE];
+    char rx[UART_RX_BUFSIZE];
+    volatile uint32_t txhead;
+    volatile uint32_t txtail;
+    volatile uint32_t rxhead;
+    volatile uint32_t rxtail;
+    volatile uint32_t dropped;
+    uint32_t irq;
+    /** @brief Core that takes UART0_IRQ */
+    uint32_t core;
+    spinlock_t lock;
+} ring;
+
+void uart_init() {
+    AT8(UART_IER) = 0;
+    uart_set_baudrate(BAUDRATE);
+    AT8(UART_FCR) = UART_FCR_ENABLE | UART_FCR_CLEAR_RX | UART_FCR_CLEAR_TX;
+}
+
+void uart_irq_enable(uint32_t rxlevel, uint32_t txlevel) {
+    // RX trigger levels of 1, 4, 8 and 14 bytes, nearest to UARTIFLS_<X>
+    static const uint8_t trig[] = {0, 1, 2, 3, 3};
+
+    if (rxlevel > UARTIFLS_7_8 || txlevel > UARTIFLS_7_8) {
+        breakpoint();
+    }
+
+    AT8(UART_FCR) = UART_FCR_ENABLE | (trig[rxlevel] << UART_FCR_TRIG_SHIFT);
+    AT8(UART_MCR) = UART_MCR_OUT2;
+    // TX is only unmasked while the TX ring has data, see _tx_fill
+    AT8(UART_IER) = UART_IER_RDI;
+    ring.core = csr_read(mhartid);
+    ring.irq = 1;
+    irq_enable(UART0_IRQ);
+}
+
+void uart_putc(char c) {
+    if (!ring.irq) {
+        _putc(c);
+        return;
+    }
+    uart_write(&c, 1);
+}
+
+char uart_getc() {
+    char c;
+
+    if (!ring.irq) {
+        return _getc();
+    }
+    uart_read(&c, 1);
+    return c;
+}
+
+void uart_write(const char *buf, uint32_t n) {
+    uint32_t mie;
+
+    if (!ring.irq) {
+        while (n--) {
+            _putc(*buf++);
+        }
+        return;
+    }
+
+    mie = spinlock_lock_irqsave(&ring.lock);
+    while (n) {
+        while (n && ring.txhead - ring.txtail < UART_TX_BUFSIZE) {
+            ring.tx[ring.txhead++ & TX_MASK] = *buf++;
+            n--;
+        }
+        _tx_fill();
+        if (n) {
+            _idle(mie);
+        }
+    }
+    spinlock_unlock_irqrestore(&ring.lock, mie);
+}
+
+uint32_t uart_read(char *buf, uint32_t n) {
+    uint32_t mie;
+    uint32_t i = 0;
+
+    if (!ring.irq) {
+        buf[0] = _getc();
+        return 1;
+    }
+
+    mie = spinlock_lock_irqsave(&ring.lock);
+    while (ring.rxhead == ring.rxtail) {
+        _idle(mie);
+    }
+    while (i < n && ring.rxtail != ring.rxhead) {
+        buf[i++] = ring.rx[ring.rxtail++ & RX_MASK];
+    }
+    spinlock_unlock_irqrestore(&ring.lock, mie);
+    return i;
+}
+
+void uart_flush() {
+    uint32_t mie = spinlock_lock_irqsave(&ring.lock);
+
+    while (ring.txhead != ring.txtail) {
+        _idle(mie);
+    }
+    spinlock_unlock_irqrestore(&ring.lock, mie);
+
+    while (!(AT8(UART_LSR) & UART_LSR_TEMT))
+        ;
+}
+
+int32_t uart_write_dma(const char *buf, uint32_t n, void (*done)(void *),
+                       void *arg) {
+    (void)buf, (void)n, (void)done, (void)arg;
+    return -1;
+}
+
+int32_t uart_read_dma(char *buf, uint32_t n, void (*done)(void *),
+                      void *arg) {
+    (void)buf, (void)n, (void)done, (void)arg;
+    return -1;
+}
+
+uint32_t uart_rx_dropped() {
+    return ring.dropped;
+}
+
+/**
+ * @brief UART0 interrupt handler, overrides the weak definition in startup.S.
+ */
+void isr_irq10() {
+    uint32_t mie = spinlock_lock_irqsave(&ring.lock);
+
+    // reading IIR acknowledges THR empty, draining RBR the rest
+    while (!(AT8(UART_IIR) & UART_IIR_NO_INT)) {
+        _rx_drain();
+        _tx_fill();
+    }
+    spinlock_unlock_irqrestore(&ring.lock, mie);
+}
+
+static void _putc(char c) {
+    while (!(AT8(UART_LSR) & UART_LSR_THRE))
+        ;
+    AT8(UART_THR) = c;
+}
+
+static char _getc() {
+    while (!(AT8(UART_LSR) & UART_LSR_DR))
+        ;
+    return AT8(UART_RBR);
+}
+
+// Moves up to a FIFO's worth of bytes from the TX ring once the FIFO has
+// drained. THR empty is unmasked only while the ring has more.
+static void _tx_fill() {
+    if (AT8(UART_LSR) & UART_LSR_THRE) {
+        for (uint32_t i = 0; i < UART_FIFO_SIZE && ring.txtail != ring.txhead;
+             i++) {
+            AT8(UART_THR) = ring.tx[ring.txtail++ & TX_MASK];
+        }
+    }
+    if (ring.txtail == ring.txhead) {
+        AT8(UART_IER) = UART_IER_RDI;
+    } else {
+        AT8(UART_IER) = UART_IER_RDI | UART_IER_THRI;
+    }
+}
+
+static void _rx_drain() {
+    uint32_t lsr;
+    char c;
+
+    while ((lsr = AT8(UART_LSR)) & UART_LSR_DR) {
+        c = AT8(UART_RBR);
+        if ((lsr & UART_LSR_ERR_MASK) ||
+            ring.rxhead - ring.rxtail == UART_RX_BUFSIZE) {
+            ring.dropped++;
+            continue;
+        }
+        ring.rx[ring.rxhead++ & RX_MASK] = c;
+    }
+}
+
+// See _idle in kernel/uart.c
+static void _idle(uint32_t mie) {
+    if (!mie) {
+        _tx_fill();
+        _rx_drain();
+        return;
+    }
+    spinlock_unlock(&ring.lock);
+    if (csr_read(mhartid) == ring.core) {
+        wfi();
+        irq_restore(mie);
+        irq_save();
+    }
+    spinlock_lock(&ring.lock);
+}
+
+uint32_t uart_set_baudrate(uint32_t baudrate) {
+    uint32_t div = UART_CLOCK_HZ / (16 * baudrate);
+
+    if (!div) {
+        div = 1;
+    }
+
+    AT8(UART_LCR) = UART_LCR_DLAB;
+    AT8(UART_RBR) = div & 0xff;
+    AT8(UART_IER) = div >> 8;
+    AT8(UART_LCR) = UART_LCR_8N1;
+
+    return UART_CLOCK_HZ / (16 * div);
+}
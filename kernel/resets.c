@@ -39,6 +39,15 @@ __inline void pll_usb_reset_cycle() {
     _unreset_blocking(PLL_USB_BLOCKNUM);
 }
 
+__inline void pll_reset_cycle() {
+    uint32_t mask = (1 << PLL_SYS_BLOCKNUM) | (1 << PLL_USB_BLOCKNUM);
+
+    AT(RESETS_RESET + ATOMIC_BITSET_OFFSET) = mask;
+    AT(RESETS_RESET + ATOMIC_BITCLR_OFFSET) = mask;
+    while ((AT(RESETS_RESET_DONE) & mask) != mask)
+        ;
+}
+
 __inline void uart_reset_cycle() {
     _reset(UART0_BLOCKNUM);
     _unreset_blocking(UART0_BLOCKNUM);
@@ -54,6 +54,11 @@ void pll_sys_reset_cycle();
  */
 void pll_usb_reset_cycle();
 
+/**
+ * @brief Resets both PLLs together, then unresets, blocking until complete.
+ */
+void pll_reset_cycle();
+
 /**
  * @brief Resets UART (instance 0), then unresets, blocking until complete.
  */
@@ -0,0 +1,116 @@
+/**
+ * @file ring.c
+ * @brief Implements the lock-free ring buffers.
+ *
+ * Indices are free-running, so head - tail is the fill level even after
+ * they wrap, as long as the capacity is a power of two.
+ *
+ * @author Herbie Rand
+ */
+
+#include "ring.h"
+#include "asm.h"
+#include "types.h"
+
+void spsc_init(spsc_t *r, uint32_t *buf, uint32_t size) {
+    if (!size || (size & (size - 1))) {
+        breakpoint();
+    }
+    r->head = 0;
+    r->tail = 0;
+    r->mask = size - 1;
+    r->buf = buf;
+}
+
+uint32_t spsc_push(spsc_t *r, uint32_t v) {
+    uint32_t head = r->head;
+    // acquire, so the consumer is done with the slot before we overwrite it
+    uint32_t tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+
+    if (head - tail > r->mask) {
+        return 0;
+    }
+    r->buf[head & r->mask] = v;
+    // release, so the value is visible before the slot is published
+    __atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+uint32_t spsc_pop(spsc_t *r, uint32_t *v) {
+    uint32_t tail = r->tail;
+    uint32_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+
+    if (head == tail) {
+        return 0;
+    }
+    *v = r->buf[tail & r->mask];
+    __atomic_store_n(&r->tail, tail + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+uint32_t spsc_count(const spsc_t *r) {
+    return __atomic_load_n(&r->head, __ATOMIC_ACQUIRE) -
+           __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+}
+
+// Bounded MPSC queue after D. Vyukov's bounded MPMC queue. Each cell's seq
+// says whose turn it is: seq == pos means free for the producer claiming
+// position pos, seq == pos + 1 means filled for the consumer reading pos.
+// Producers claim positions with a CAS on head, so a producer preempted
+// after claiming never blocks the others.
+
+void mpsc_init(mpsc_t *r, mpsc_cell_t *cells, uint32_t size) {
+    if (!size || (size & (size - 1))) {
+        breakpoint();
+    }
+    for (uint32_t i = 0; i < size; i++) {
+        cells[i].seq = i;
+    }
+    r->head = 0;
+    r->tail = 0;
+    r->mask = size - 1;
+    r->cells = cells;
+}
+
+uint32_t mpsc_push(mpsc_t *r, uint32_t v) {
+    uint32_t pos = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+    mpsc_cell_t *c;
+    int32_t diff;
+
+    for (;;) {
+        c = &r->cells[pos & r->mask];
+        diff = (int32_t)(__atomic_load_n(&c->seq, __ATOMIC_ACQUIRE) - pos);
+        if (diff == 0) {
+            // on failure, pos is reloaded with the current head
+            if (__atomic_compare_exchange_n(&r->head, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // the consumer has not freed this cell yet
+            return 0;
+        } else {
+            // another producer claimed pos first
+            pos = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    c->val = v;
+    __atomic_store_n(&c->seq, pos + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+uint32_t mpsc_pop(mpsc_t *r, uint32_t *v) {
+    uint32_t pos = r->tail;
+    mpsc_cell_t *c = &r->cells[pos & r->mask];
+
+    if (__atomic_load_n(&c->seq, __ATOMIC_ACQUIRE) != pos + 1) {
+        return 0;
+    }
+    *v = c->val;
+    // free the cell for the producer one lap ahead
+    __atomic_store_n(&c->seq, pos + r->mask + 1, __ATOMIC_RELEASE);
+    r->tail = pos + 1;
+    return 1;
+}
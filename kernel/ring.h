@@ -0,0 +1,94 @@
+/**
+ * @file ring.h
+ * @brief Lock-free bounded ring buffers of 32-bit words (integers or
+ *        pointers), over caller-provided storage.
+ *
+ * spsc_t has one producer and one consumer, which may be on different
+ * cores, or a task and an ISR. mpsc_t allows any number of producers, e.g.
+ * several ISRs and the other core, and a single consumer. Neither disables
+ * interrupts, and neither blocks: push fails when full, pop when empty.
+ *
+ * NOTE: storage must be in SRAM, see atomic.h.
+ *
+ * @author Herbie Rand
+ */
+
+#ifndef RING_H
+#define RING_H
+
+#include "types.h"
+
+typedef struct {
+    /** @brief Next slot to write, only written by the producer */
+    volatile uint32_t head;
+    /** @brief Next slot to read, only written by the consumer */
+    volatile uint32_t tail;
+    uint32_t mask;
+    uint32_t *buf;
+} spsc_t;
+
+typedef struct {
+    /** @brief Position the slot is ready for, see ring.c */
+    volatile uint32_t seq;
+    uint32_t val;
+} mpsc_cell_t;
+
+typedef struct {
+    /** @brief Next position to claim, shared by producers */
+    volatile uint32_t head;
+    /** @brief Next position to read, only written by the consumer */
+    uint32_t tail;
+    uint32_t mask;
+    mpsc_cell_t *cells;
+} mpsc_t;
+
+/**
+ * @brief Initializes an empty ring.
+ * @param r     Ring
+ * @param buf   Storage for size words
+ * @param size  Integer capacity, a power of two
+ */
+void spsc_init(spsc_t *r, uint32_t *buf, uint32_t size);
+
+/**
+ * @brief Appends a word. Producer only.
+ * @returns 1 on success, 0 if the ring is full
+ */
+uint32_t spsc_push(spsc_t *r, uint32_t v);
+
+/**
+ * @brief Removes the oldest word. Consumer only.
+ * @returns 1 on success, 0 if the ring is empty
+ */
+uint32_t spsc_pop(spsc_t *r, uint32_t *v);
+
+/**
+ * @brief Returns the number of words in the ring. Exact only when called
+ *        by the producer or consumer, and only as a lower (resp. upper)
+ *        bound while the other side is active.
+ */
+uint32_t spsc_count(const spsc_t *r);
+
+/**
+ * @brief Initializes an empty ring.
+ * @param r     Ring
+ * @param cells Storage for size cells
+ * @param size  Integer capacity, a power of two
+ */
+void mpsc_init(mpsc_t *r, mpsc_cell_t *cells, uint32_t size);
+
+/**
+ * @brief Appends a word. Safe from any number of producers.
+ * @returns 1 on success, 0 if the ring is full
+ */
+uint32_t mpsc_push(mpsc_t *r, uint32_t v);
+
+/**
+ * @brief Removes the oldest word. Consumer only.
+ * A producer preempted between claiming and filling its slot holds up the
+ * consumer (but no other producer) until it resumes.
+ * @returns 1 on success, 0 if the ring is empty
+ */
+uint32_t mpsc_pop(mpsc_t *r, uint32_t *v);
+
+#endif
@@ -14,16 +14,30 @@
 #define ATOMIC_BITCLR_OFFSET 0x3000
 
 // Flags for MSTATUS
-#define MIE_MASK 0x8
+#define MIE_MASK  0x8
+#define MPIE_MASK 0x80
+#define MPP_MASK  0x1800
+
+// IRQ numbers, for MEIEA and __external_interrupt_table
+#define NUM_IRQS     52
+#define DMA_IRQ_0    10
+#define SIO_IRQ_FIFO 25
+#define UART0_IRQ    33
 
 // Flags for MIE and MIP
 #define MSI_MASK 0x8
 #define MTI_MASK 0x80
 #define MEI_MASK 0x800
 
+// Fields of MEICONTEXT, external interrupts below PREEMPT are not taken.
+// Bits 20:16 are PPREEMPT, the previous threshold saved by MEINEXT.UPDATE.
+#define MEICONTEXT_PREEMPT_SHIFT 24
+#define MEICONTEXT_PREEMPT_MASK  0x1f000000
+
 #define RVCSR_PMPCFGM0   0xbd0
 #define RVCSR_MEIEA      0xbe0
 #define RVCSR_MEIFA      0xbe2
+#define RVCSR_MEIPRA     0xbe3
 #define RVCSR_MEINEXT    0xbe4
 #define RVCSR_MEICONTEXT 0xbe5
 #define RVCSR_PMPCFG0    0x3a0
@@ -31,6 +45,9 @@
 #define RVCSR_PMPCFG2    0x3a2
 #define RVCSR_PMPADDR0   0x3b0
 #define RVCSR_PMPADDR1   0x3b1
+#define RVCSR_PMPADDR2   0x3b2
+#define RVCSR_PMPADDR3   0x3b3
+#define RVCSR_PMPADDR4   0x3b4
 
 #define CLOCKS_BASE              0x40010000
 #define CLOCKS_CLK_REF_CTRL      0x40010030
@@ -57,6 +74,27 @@
 
 #define BOOTRAM_BASE 0x400e0000
 
+// XIP cache maintenance, see rp2350 datasheet section 4.4.1
+#define XIP_MAINTENANCE_BASE      0x18000000
+#define XIP_CACHE_SIZE            0x4000
+#define XIP_CACHE_LINE            8
+#define XIP_INVALIDATE_BY_SET_WAY 0x0
+
+/** @brief ROSC nominal frequency is 11 MHz */
+#define ROSC_NOMINAL_MHZ 11
+
+#define TICKS_BASE         0x40108000
+#define TICKS_RISCV_CTRL   0x4010803c
+#define TICKS_RISCV_CYCLES 0x40108040
+#define TICKS_RISCV_COUNT  0x40108044
+
+// Flags for TICKS_<X>_CTRL
+#define TICKS_CTRL_ENABLE 0x1
+
+// Flags for SIO_MTIME_CTRL
+#define MTIME_CTRL_EN        0x1
+#define MTIME_CTRL_FULLSPEED 0x2
+
 #define RESETS_BASE       0x40020000
 #define RESETS_RESET      0x40020000
 #define RESETS_WDSEL      0x40020004
@@ -133,6 +171,69 @@
 #define UARTFR_TXFE 0x80
 #define UARTFR_RI   0x100
 
+// Flags for UARTIMSC, UARTRIS, UARTMIS and UARTICR
+#define UARTINT_RX 0x10
+#define UARTINT_TX 0x20
+#define UARTINT_RT 0x40
+#define UARTINT_FE 0x80
+#define UARTINT_PE 0x100
+#define UARTINT_BE 0x200
+#define UARTINT_OE 0x400
+
+// Error flags in UARTDR (framing, parity, break, overrun)
+#define UARTDR_ERR_MASK 0xf00
+
+// FIFO trigger levels for UARTIFLS, RXIFLSEL is shifted by 3
+#define UARTIFLS_1_8         0x0
+#define UARTIFLS_1_4         0x1
+#define UARTIFLS_1_2         0x2
+#define UARTIFLS_3_4         0x3
+#define UARTIFLS_7_8         0x4
+#define UARTIFLS_RXSEL_SHIFT 3
+
+#define UART_FIFO_DEPTH 32
+
+// Flags for UARTDMACR
+#define UARTDMACR_RXDMAE 0x1
+#define UARTDMACR_TXDMAE 0x2
+
+// Channel registers are at DMA_BASE + ch * DMA_CH_STRIDE + offset
+#define DMA_BASE             0x50000000
+#define DMA_CH_STRIDE        0x40
+#define DMA_READ_ADDR        0x00
+#define DMA_WRITE_ADDR       0x04
+#define DMA_TRANS_COUNT      0x08
+#define DMA_CTRL_TRIG        0x0c
+#define DMA_AL1_CTRL         0x10
+#define DMA_AL1_READ_ADDR    0x14
+#define DMA_AL1_WRITE_ADDR   0x18
+#define DMA_AL1_TRANS_COUNT  0x1c
+#define DMA_INTR             0x50000400
+#define DMA_INTE0            0x50000404
+#define DMA_INTF0            0x50000408
+#define DMA_INTS0            0x5000040c
+#define DMA_CHAN_ABORT       0x50000464
+
+// Flags and fields for DMA CTRL
+#define DMA_CTRL_EN              0x1
+#define DMA_CTRL_HIGH_PRIORITY   0x2
+#define DMA_CTRL_DATA_SIZE_SHIFT 2
+#define DMA_CTRL_INCR_READ       0x10
+#define DMA_CTRL_INCR_WRITE      0x40
+#define DMA_CTRL_RING_SIZE_SHIFT 8
+#define DMA_CTRL_RING_SEL        0x1000
+#define DMA_CTRL_CHAIN_TO_SHIFT  13
+#define DMA_CTRL_CHAIN_TO_MASK   0x1e000
+#define DMA_CTRL_TREQ_SEL_SHIFT  17
+#define DMA_CTRL_IRQ_QUIET       0x800000
+#define DMA_CTRL_BUSY            0x4000000
+#define DMA_CTRL_ERR_MASK        0xe0000000
+
+// DREQ numbers for DMA CTRL.TREQ_SEL
+#define DREQ_UART0_TX 28
+#define DREQ_UART0_RX 29
+#define DREQ_FORCE    63
+
 #define UART0_BASE      0x40070000
 #define UART0_UARTDR    0x40070000
 #define UART0_UARTRSR   0x40070004
@@ -143,6 +244,11 @@
 #define UART0_UARTLCR_H 0x4007002c
 #define UART0_UARTCR    0x40070030
 #define UART0_UARTIFLS  0x40070034
+#define UART0_UARTIMSC  0x40070038
+#define UART0_UARTRIS   0x4007003c
+#define UART0_UARTMIS   0x40070040
+#define UART0_UARTICR   0x40070044
+#define UART0_UARTDMACR 0x40070048
 // ... etc
 
 #define UART1_BASE 0x40078000
@@ -157,6 +263,8 @@
 #define SIO_FIFO_ST       0xd0000050
 #define SIO_FIFO_WR       0xd0000054
 #define SIO_FIFO_RD       0xd0000058
+#define SIO_SPINLOCK_ST   0xd000005c
+#define SIO_SPINLOCK0     0xd0000100
 #define SIO_RISCV_SOFTIRQ 0xd00001a0
 #define SIO_MTIME_CTRL    0xd00001a4
 #define SIO_MTIME         0xd00001b0
@@ -164,6 +272,11 @@
 #define SIO_MTIMECMP      0xd00001b8
 #define SIO_MTIMECMPH     0xd00001bc
 
+#define SIO_SPINLOCK_COUNT 32
+// RP2350-E2: writes to SIO 0x180-0x1bc (doorbells, softirq, mtime) also
+// release spinlocks 0-15 at offset -0x80, so only 16-31 are reliable
+#define SIO_SPINLOCK_FIRST_SAFE 16
+
 #define ACCESSCTRL_BASE        0x40060000
 #define ACCESSCTRL_GPIO_NMASK0 0x4006000c
 #define ACCESSCTRL_GPIO_NMASK1 0x40060010
@@ -172,4 +285,9 @@
 
 #define __h3_unblock() asm("slt x0, x0, x1")
 
+// make BOARD=qemu-virt re-targets some of the above
+#ifdef BOARD_QEMU_VIRT
+#include "qemu_virt.h"
+#endif
+
 #endif
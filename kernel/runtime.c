@@ -7,7 +7,43 @@
 #include "runtime.h"
 #include "asm.h"
 #include "fifo.h"
+#include "riscv.h"
+#include "rp2350.h"
 
+void _core1_entry();
+
+extern uint32_t __vector_table;
+extern uint32_t __mstack0_base;
+extern uint32_t __mstack1_base;
+
+cpu_t cpus[NUM_CORES];
+
+/** @brief Entry function of core 1, picked up by _core1_entry */
+void (*core1_main)();
+
+/** @brief Set by softirq_set for each core, taken by softirq_take */
+static uint32_t raised[NUM_CORES];
+
+void cpu_init() {
+    uint32_t id = csr_read(mhartid);
+    cpu_t *cpu = &cpus[id];
+
+    cpu->mstack = id ? (uint32_t)&__mstack1_base : (uint32_t)&__mstack0_base;
+    cpu->id = id;
+    asm volatile("mv tp, %0" : : "r"(cpu));
+    __atomic_store_n(&cpu->online, 1, __ATOMIC_RELEASE);
+}
+
+void launch_core1(void (*entry)()) {
+    core1_main = entry;
+    init_core1((uint32_t)&__vector_table, (uint32_t)&__mstack1_base,
+               (uint32_t)_core1_entry);
+    while (!__atomic_load_n(&cpus[1].online, __ATOMIC_ACQUIRE))
+        ;
+}
+
+// BOARD_QEMU_VIRT parks core 1 itself, see kernel/qemu_virt/platform.c
+#ifndef BOARD_QEMU_VIRT
 void init_core1(uint32_t vt, uint32_t sp, uint32_t pc) {
     uint32_t cmd;
     uint32_t resp;
@@ -32,3 +68,29 @@ void init_core1(uint32_t vt, uint32_t sp, uint32_t pc) {
         i = (cmd == resp) ? (i + 1) : 0;
     } while (i < 6);
 }
+#endif
+
+void softirq_set(uint32_t core) {
+    __atomic_store_n(&raised[core], 1, __ATOMIC_RELEASE);
+    softirq_raise(core);
+}
+
+uint32_t softirq_take() {
+    return __atomic_exchange_n(&raised[this_cpu()->id], 0, __ATOMIC_ACQ_REL);
+}
+
+void softirq_raise(uint32_t core) {
+#ifdef BOARD_QEMU_VIRT
+    AT(CLINT_MSIP + 4 * core) = 1;
+#else
+    AT(SIO_RISCV_SOFTIRQ) = 1UL << core;
+#endif
+}
+
+void softirq_clear(uint32_t core) {
+#ifdef BOARD_QEMU_VIRT
+    AT(CLINT_MSIP + 4 * core) = 0;
+#else
+    AT(SIO_RISCV_SOFTIRQ) = 0x100UL << core;
+#endif
+}
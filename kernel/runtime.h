@@ -1,6 +1,14 @@
 /**
  * @file runtime.h
  * @brief Defines functions to initialize multicore runtime.
+ *
+ * Both cores run the kernel from the same image and vector table, each on
+ * its own M-mode stack (__mstackN) and U-mode stack (__ustackN). Each core
+ * keeps a pointer to its own cpu_t in tp while in M-mode. U-mode may write
+ * tp like any other register, so every trap handler points it at
+ * cpus[mhartid] again on entry, and gives the interrupted code its own tp
+ * back on the way out.
+ *
  * @author Herbie Rand
  */
 
@@ -9,10 +17,61 @@
 
 #include "types.h"
 
+#define NUM_CORES 2
+
+struct sched_cpu;
+
+/** @brief Per-core state, 16 bytes, startup.S indexes cpus by mhartid */
+typedef struct cpu {
+    /**
+     * @brief Top of the free part of this core's M-mode stack, lowered by
+     *        user_call while it runs, must stay first (startup.S)
+     */
+    uint32_t mstack;
+    /** @brief Core number, same as mhartid */
+    uint32_t id;
+    /** @brief Nonzero once the core has entered the kernel */
+    volatile uint32_t online;
+    /** @brief Scheduler state of this core, 0 until it schedules tasks */
+    struct sched_cpu *sched;
+} cpu_t;
+
+extern cpu_t cpus[NUM_CORES];
+
+/**
+ * @brief Returns the calling core's cpu_t.
+ */
+static __inline cpu_t *this_cpu() {
+#ifdef HOST
+    return &cpus[0];
+#else
+    cpu_t *cpu;
+    asm("mv %0, tp" : "=r"(cpu));
+    return cpu;
+#endif
+}
+
+/**
+ * @brief Points tp at the calling core's cpu_t and marks the core online.
+ * Called by the boot code of each core, before anything else in C.
+ */
+void cpu_init();
+
+/**
+ * @brief Boots core 1 into the kernel, on the shared vector table and
+ *        __mstack1, then calls entry in M-mode with interrupts enabled,
+ *        like `main` in tests. Returns once core 1 is online.
+ * @param entry Function to run on core 1, returning lands in jail
+ */
+void launch_core1(void (*entry)());
+
 /**
  * @brief Initializes core 1 with the provided vector table address,
  *        stack pointer, and program counter.
  *
+ * Low-level, the code at pc starts with no kernel state (no gp or tp), so
+ * prefer `launch_core1`.
+ *
  * @param vt    Integer vector table address
  * @param sp    Integer stack pointer
  * @param pc    Integer program counter
@@ -21,4 +80,31 @@
  */
 void init_core1(uint32_t vt, uint32_t sp, uint32_t pc);
 
+/**
+ * @brief Raises a machine software interrupt (isr_msi) on a core, for
+ *        isr_soft_irq there.
+ * @param core  Integer core number, may be the calling core
+ */
+void softirq_set(uint32_t core);
+
+/**
+ * @brief Returns nonzero if softirq_set was called for the calling core
+ *        since the last call, and clears the record. Tells those apart from
+ *        raises by work_queue, which share the same pending bit.
+ */
+uint32_t softirq_take();
+
+/**
+ * @brief Raises a machine software interrupt on a core, like softirq_set,
+ *        without recording it for softirq_take. Used by work_queue.
+ * @param core  Integer core number, may be the calling core
+ */
+void softirq_raise(uint32_t core);
+
+/**
+ * @brief Clears a core's pending machine software interrupt.
+ * @param core  Integer core number
+ */
+void softirq_clear(uint32_t core);
+
 #endif
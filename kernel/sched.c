@@ -0,0 +1,426 @@
+/**
+ * @file sched.c
+ * @brief Implements the preemptive priority scheduler.
+ *
+ * Each core has its own ready queues, idle task and tick, in a sched_cpu_t
+ * reached through its cpu_t. A core's queues are protected by a spinlock
+ * that the owner takes on every switch and spawn, and the other core only
+ * takes when stealing. A core never holds both locks at once. Locks are only
+ * taken in M-mode with interrupts off, so a holder is never preempted.
+ *
+ * @author Herbie Rand
+ */
+
+#include "sched.h"
+#include "asm.h"
+#include "clock.h"
+#include "irq_stats.h"
+#include "mtime.h"
+#include "riscv.h"
+#include "rp2350.h"
+#include "runtime.h"
+#include "section.h"
+#include "spinlock.h"
+#include "timer.h"
+#include "types.h"
+
+// stack slot 0 holds core 0's idle task, core 1's idle task runs on
+// __ustack1, which only core 1 maps. Neither is ever queued.
+#define IDLE_SLOT 0
+
+extern uint32_t __ustacks_limit;
+extern uint32_t __ustack1_base;
+
+void _jail();
+void task_idle();
+
+typedef struct {
+    /** @brief Left zeroed, a ticket lock, usable before the core starts */
+    spinlock_t lock;
+    task_t *head[TASK_PRIO_COUNT];
+    task_t *tail[TASK_PRIO_COUNT];
+    /** @brief Bitmap of non-empty ready queues, indexed by priority */
+    volatile uint32_t ready;
+} runq_t;
+
+typedef struct sched_cpu {
+    task_t *current;
+    task_t idle;
+    runq_t rq;
+    /** @brief Set by the tick and by yields, cleared on the next switch */
+    uint32_t resched;
+    uint32_t stamp;
+    ktimer_t tick;
+    sched_stats_t stats;
+} sched_cpu_t;
+
+static task_t tasks[TASK_MAX];
+static sched_cpu_t percpu[NUM_CORES];
+static uint32_t quantum;
+
+static void _secondary();
+static void _cpu_init(uint32_t idle_sp);
+static uint32_t _context_init(uint32_t base, uint32_t pc);
+static __inline uint32_t _slot_base(uint32_t slot);
+static void _enqueue(runq_t *rq, task_t *t);
+static task_t *_dequeue(runq_t *rq, uint32_t prio);
+static __inline uint32_t _top_prio(runq_t *rq);
+static task_t *_steal(sched_cpu_t *c);
+static uint32_t _switch(uint32_t sp);
+static void _sched_init();
+static void _tick(void *arg);
+static void _wake(void *arg);
+
+int32_t sched_spawn(void (*entry)(), uint32_t prio) {
+    sched_cpu_t *c = &percpu[this_cpu()->id];
+    uint32_t expected;
+    uint32_t mie;
+
+    if (prio >= TASK_PRIO_COUNT) {
+        breakpoint();
+    }
+
+    for (uint32_t i = 1; i < TASK_MAX; i++) {
+        // slots are freed by whichever core last ran the task
+        expected = TASK_UNUSED;
+        if (!__atomic_compare_exchange_n(&tasks[i].state, &expected,
+                                         TASK_READY, 0, __ATOMIC_ACQUIRE,
+                                         __ATOMIC_RELAXED)) {
+            continue;
+        }
+        tasks[i].sp = _context_init(_slot_base(i), (uint32_t)entry);
+        tasks[i].prio = prio;
+        tasks[i].pinned = 0;
+        mie = spinlock_lock_irqsave(&c->rq.lock);
+        _enqueue(&c->rq, &tasks[i]);
+        spinlock_unlock_irqrestore(&c->rq.lock, mie);
+
+        // preempt within the current tick if the new task outranks us
+        if (this_cpu()->sched && prio > c->current->prio) {
+            sched_yield();
+        }
+        return i;
+    }
+    return -1;
+}
+
+void sched_pin(int32_t id) {
+    // e.g. -1 from sched_spawn on a full table, or the idle slot
+    if (id < 1 || id >= TASK_MAX) {
+        return;
+    }
+    tasks[id].pinned = 1;
+}
+
+void sched_start() {
+    _sched_init();
+    _cpu_init(_context_init(_slot_base(IDLE_SLOT), (uint32_t)task_idle));
+    if (SCHED_CORES > 1) {
+        launch_core1(_secondary);
+    }
+    percpu[0].current = &percpu[0].idle;
+    pmp_user_init();
+    context_restore(_switch(percpu[0].idle.sp));
+}
+
+void sched_adopt() {
+    sched_cpu_t *c = &percpu[0];
+
+    // main keeps running on __ustack0, its context is saved on the next tick
+    tasks[1].prio = TASK_PRIO_MAIN;
+    tasks[1].pinned = 1;
+    tasks[1].state = TASK_RUNNING;
+    _sched_init();
+    _cpu_init(_context_init(_slot_base(IDLE_SLOT), (uint32_t)task_idle));
+    c->current = &tasks[1];
+    if (SCHED_CORES > 1) {
+        launch_core1(_secondary);
+    }
+}
+
+void sched_yield() {
+    sched_cpu_t *c = this_cpu()->sched;
+
+    // fire the timer interrupt as soon as the current trap returns
+    if (c) {
+        c->resched = 1;
+    }
+    timer_kick();
+}
+
+void sched_exit() {
+    this_cpu()->sched->current->state = TASK_DEAD;
+    sched_yield();
+}
+
+void sched_sleep(uint64_t deadline) {
+    task_t *t = this_cpu()->sched->current;
+
+    t->state = TASK_BLOCKED;
+    timer_start(&t->wake, deadline, _wake, t);
+    sched_yield();
+}
+
+uint32_t sched_running() {
+    return this_cpu()->sched != 0;
+}
+
+task_t *sched_current() {
+    sched_cpu_t *c = this_cpu()->sched;
+
+    return c ? c->current : 0;
+}
+
+uint32_t sched_live() {
+    uint32_t n = 0;
+    uint32_t state;
+
+    for (uint32_t i = 1; i < TASK_MAX; i++) {
+        state = __atomic_load_n(&tasks[i].state, __ATOMIC_ACQUIRE);
+        if (state == TASK_READY || state == TASK_RUNNING ||
+            state == TASK_BLOCKED) {
+            n++;
+        }
+    }
+    return n;
+}
+
+sched_stats_t *sched_stats(uint32_t core) {
+    return &percpu[core].stats;
+}
+
+__time_critical uint32_t sched_mti(uint32_t sp) {
+    sched_cpu_t *c = this_cpu()->sched;
+#ifdef IRQ_STATS
+    uint32_t start = csr_read(mcycle);
+    uint32_t late = AT(SIO_MTIME) - AT(SIO_MTIMECMP);
+#endif
+
+    timer_irq();
+#ifdef IRQ_STATS
+    irq_stats_record(IRQ_STATS_MTI, start, late);
+#endif
+
+    if (!c || !c->resched) {
+        return sp;
+    }
+
+    // only switch away from U-mode, never from a preempted M-mode handler.
+    // a pending yield is then serviced on the next tick instead.
+    if (csr_read(mstatus) & MPP_MASK) {
+        return sp;
+    }
+    c->resched = 0;
+    return _switch(sp);
+}
+
+// Entry of core 1, launched in M-mode on __mstack1
+static void _secondary() {
+    sched_cpu_t *c = &percpu[1];
+
+    _cpu_init(_context_init((uint32_t)&__ustack1_base, (uint32_t)task_idle));
+    c->current = &c->idle;
+    pmp_user_init();
+    context_restore(_switch(c->idle.sp));
+}
+
+static void _sched_init() {
+    // mtime only ticks at its nominal rate once clk_ref runs from the XOSC
+    if (!clk_ref_freq_mhz()) {
+        clock_defaults_set();
+    }
+    quantum = us_to_ticks(SCHED_QUANTUM_US);
+}
+
+// Sets up the calling core's idle task and tick, and publishes its state
+static void _cpu_init(uint32_t idle_sp) {
+    cpu_t *cpu = this_cpu();
+    sched_cpu_t *c = &percpu[cpu->id];
+
+    c->idle.sp = idle_sp;
+    c->idle.state = TASK_READY;
+    c->idle.pinned = 1;
+    c->stats.min = MAX_UINT32;
+
+    mtimer_enable();
+    timer_start(&c->tick, mtime_read() + quantum, _tick, c);
+    cpu->sched = c;
+}
+
+// Periodic, re-armed from its own deadline so the tick does not drift
+static void _tick(void *arg) {
+    sched_cpu_t *c = arg;
+
+    c->resched = 1;
+    timer_start(&c->tick, c->tick.deadline + quantum, _tick, c);
+}
+
+// Timer callback of sched_sleep, on the core the task went to sleep on
+static void _wake(void *arg) {
+    sched_cpu_t *c = this_cpu()->sched;
+    task_t *t = arg;
+
+    // a deadline already past fires before the task is switched out, so
+    // it just keeps running
+    if (t == c->current) {
+        t->state = TASK_RUNNING;
+        return;
+    }
+    spinlock_lock(&c->rq.lock);
+    _enqueue(&c->rq, t);
+    spinlock_unlock(&c->rq.lock);
+    if (c->current == &c->idle || t->prio > c->current->prio) {
+        c->resched = 1;
+    }
+}
+
+// Builds an initial context below the given stack top. Tasks start in
+// U-mode with interrupts enabled, and return to jail like main does.
+static uint32_t _context_init(uint32_t base, uint32_t pc) {
+    context_t *ctx = (context_t *)(base - sizeof(context_t));
+    uint32_t *words = (uint32_t *)ctx;
+
+    for (uint32_t i = 0; i < sizeof(context_t) / 4; i++) {
+        words[i] = 0;
+    }
+    asm volatile("mv %0, gp" : "=r"(ctx->gp));
+    ctx->ra = (uint32_t)_jail;
+    ctx->mepc = pc;
+    ctx->mstatus = MPIE_MASK;
+
+    return (uint32_t)ctx;
+}
+
+// Returns the top of a task stack slot in .ustacks
+static __inline uint32_t _slot_base(uint32_t slot) {
+    return (uint32_t)&__ustacks_limit + (slot + 1) * TASK_STACK_SIZE;
+}
+
+__time_critical static void _enqueue(runq_t *rq, task_t *t) {
+    t->state = TASK_READY;
+    t->next = 0;
+    if (rq->head[t->prio]) {
+        rq->tail[t->prio]->next = t;
+    } else {
+        rq->head[t->prio] = t;
+    }
+    rq->tail[t->prio] = t;
+    rq->ready |= (1 << t->prio);
+}
+
+__time_critical static task_t *_dequeue(runq_t *rq, uint32_t prio) {
+    task_t *t = rq->head[prio];
+    rq->head[prio] = t->next;
+    if (!t->next) {
+        rq->ready &= ~(1 << prio);
+    }
+    return t;
+}
+
+static __inline uint32_t _top_prio(runq_t *rq) {
+    return 31 - __builtin_clz(rq->ready);
+}
+
+// Takes the highest priority unpinned task queued on another core
+__time_critical static task_t *_steal(sched_cpu_t *c) {
+    runq_t *rq;
+    task_t **link;
+    task_t *prev;
+    task_t *t = 0;
+    uint32_t ready;
+    uint32_t prio;
+
+    for (uint32_t i = 0; i < SCHED_CORES; i++) {
+        rq = &percpu[i].rq;
+        // peek without the lock, an idle core must not slow the busy one
+        if (rq == &c->rq || !rq->ready) {
+            continue;
+        }
+        spinlock_lock(&rq->lock);
+        for (ready = rq->ready; ready && !t; ready &= ~(1 << prio)) {
+            prio = 31 - __builtin_clz(ready);
+            prev = 0;
+            for (link = &rq->head[prio]; *link; link = &(*link)->next) {
+                if (!(*link)->pinned) {
+                    t = *link;
+                    break;
+                }
+                prev = *link;
+            }
+            if (!t) {
+                continue;
+            }
+            *link = t->next;
+            if (rq->tail[prio] == t) {
+                rq->tail[prio] = prev;
+            }
+            if (!rq->head[prio]) {
+                rq->ready &= ~(1 << prio);
+            }
+        }
+        spinlock_unlock(&rq->lock);
+        if (t) {
+            c->stats.steals++;
+            return t;
+        }
+    }
+    return 0;
+}
+
+__time_critical static uint32_t _switch(uint32_t sp) {
+    sched_cpu_t *c = this_cpu()->sched;
+    task_t *prev = c->current;
+    task_t *next = 0;
+    uint32_t now = csr_read(mcycle);
+    uint32_t delta;
+
+    prev->sp = sp;
+    spinlock_lock(&c->rq.lock);
+    if (prev->state == TASK_RUNNING && prev != &c->idle) {
+        // keep running unless a task of equal or higher priority is ready
+        if (!c->rq.ready || _top_prio(&c->rq) < prev->prio) {
+            spinlock_unlock(&c->rq.lock);
+            return sp;
+        }
+        // from here on, the other core may steal prev and resume it
+        _enqueue(&c->rq, prev);
+    } else if (prev->state == TASK_DEAD) {
+        // we are no longer on its stack, so the slot can be reused
+        __atomic_store_n(&prev->state, TASK_UNUSED, __ATOMIC_RELEASE);
+    }
+    if (c->rq.ready) {
+        next = _dequeue(&c->rq, _top_prio(&c->rq));
+    }
+    spinlock_unlock(&c->rq.lock);
+
+    if (!next) {
+        next = _steal(c);
+    }
+    if (!next) {
+        next = &c->idle;
+    }
+    if (next == prev) {
+        return sp;
+    }
+    if (prev == &c->idle) {
+        prev->state = TASK_READY;
+    }
+    c->current = next;
+    next->state = TASK_RUNNING;
+
+    if (c->stats.switches) {
+        delta = now - c->stamp;
+        c->stats.last = delta;
+        c->stats.total += delta;
+        if (delta < c->stats.min) {
+            c->stats.min = delta;
+        }
+        if (delta > c->stats.max) {
+            c->stats.max = delta;
+        }
+    }
+    c->stats.switches++;
+    c->stamp = now;
+
+    return next->sp;
+}
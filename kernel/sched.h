@@ -0,0 +1,207 @@
+/**
+ * @file sched.h
+ * @brief Preemptive priority scheduler for U-mode tasks.
+ *
+ * Tasks run in U-mode on their own stacks, carved out of the `.ustacks`
+ * linker region. Context is saved onto the interrupted task's stack by
+ * `isr_mti`, and the scheduler picks the highest priority ready task on
+ * every tick, round-robin among tasks of equal priority. The tick is a
+ * periodic timer of the timer service (timer.h).
+ *
+ * With SCHED_CORES = 2, both cores schedule tasks, each from its own ready
+ * queues with its own tick, and there is no global lock: a core only takes
+ * the lock of its own queues, except when it runs out of work and steals the
+ * highest priority task queued on the other core. Tasks spawned on a core
+ * are queued there, so the other core picks them up within a tick.
+ *
+ * @author Herbie Rand
+ */
+
+#ifndef SCHED_H
+#define SCHED_H
+
+#include "timer.h"
+#include "types.h"
+
+/**
+ * @brief Task slots, including the idle task's slot 0, so at most
+ *        TASK_MAX - 1 tasks can be spawned
+ */
+#define TASK_MAX 8
+/** @brief Stack size of each task, TASK_MAX * this must match .ustacks */
+#define TASK_STACK_SIZE 0x1000
+/** @brief Number of priority levels, higher number = higher priority */
+#define TASK_PRIO_COUNT 8
+/** @brief Priority given to `main` when it is adopted as a task */
+#define TASK_PRIO_MAIN 1
+/** @brief Scheduler tick period */
+#define SCHED_QUANTUM_US 10000
+/** @brief Number of cores scheduling tasks, 1 or 2 */
+#define SCHED_CORES 2
+
+#define TASK_UNUSED  0
+#define TASK_READY   1
+#define TASK_RUNNING 2
+#define TASK_DEAD    3
+#define TASK_BLOCKED 4
+
+/**
+ * @brief Register context, pushed onto the task stack by `isr_mti`.
+ * Layout must match the save_context/restore_context macros in startup.S.
+ * tp is only restored into U-mode, see runtime.h.
+ */
+typedef struct {
+    uint32_t ra;
+    uint32_t gp;
+    uint32_t tp;
+    uint32_t t0;
+    uint32_t t1;
+    uint32_t t2;
+    uint32_t s0;
+    uint32_t s1;
+    uint32_t a0;
+    uint32_t a1;
+    uint32_t a2;
+    uint32_t a3;
+    uint32_t a4;
+    uint32_t a5;
+    uint32_t a6;
+    uint32_t a7;
+    uint32_t s2;
+    uint32_t s3;
+    uint32_t s4;
+    uint32_t s5;
+    uint32_t s6;
+    uint32_t s7;
+    uint32_t s8;
+    uint32_t s9;
+    uint32_t s10;
+    uint32_t s11;
+    uint32_t t3;
+    uint32_t t4;
+    uint32_t t5;
+    uint32_t t6;
+    uint32_t mepc;
+    uint32_t mstatus;
+} context_t;
+
+/** @brief Task control block */
+typedef struct task {
+    /** @brief Saved stack pointer, points at a context_t when not running */
+    uint32_t sp;
+    /** @brief Priority, 0 to TASK_PRIO_COUNT - 1 */
+    uint32_t prio;
+    /** @brief One of TASK_UNUSED, TASK_READY, TASK_RUNNING, TASK_DEAD,
+     *         TASK_BLOCKED */
+    uint32_t state;
+    /** @brief Nonzero if the task may not migrate to the other core */
+    uint32_t pinned;
+    /** @brief Next task in the same ready queue */
+    struct task *next;
+    /** @brief Wakes the task from sched_sleep */
+    ktimer_t wake;
+} task_t;
+
+/**
+ * @brief Context switch statistics, in mcycle.
+ *
+ * A sample is the time between two consecutive switches, so with tasks
+ * that only yield it is the full yield-to-yield round trip. Kept per core.
+ */
+typedef struct {
+    uint32_t switches;
+    /** @brief Tasks taken from the other core's queues */
+    uint32_t steals;
+    uint32_t last;
+    uint32_t min;
+    uint32_t max;
+    uint32_t total;
+} sched_stats_t;
+
+/**
+ * @brief Creates a U-mode task, ready to run, queued on the calling core.
+ * @param entry Task entry point, must be in user text. Tasks must not return,
+ *              they should call `task_exit` instead.
+ * @param prio  Integer priority, higher preempts lower
+ * @returns Integer task id, or -1 if no slot is free
+ */
+int32_t sched_spawn(void (*entry)(), uint32_t prio);
+
+/**
+ * @brief Keeps a task on the core it is queued on, so it is never stolen.
+ * Must be called before the scheduler starts.
+ * @param id    Integer task id, as returned by `sched_spawn`; ids outside
+ *              [1, TASK_MAX), such as its -1, are ignored
+ */
+void sched_pin(int32_t id);
+
+/**
+ * @brief Starts the scheduler by switching to the highest priority task.
+ * Also launches core 1 into the scheduler if SCHED_CORES is 2.
+ * Does not return. Must be called from M-mode, on core 0.
+ */
+void sched_start();
+
+/**
+ * @brief Requests a reschedule as soon as the current trap returns.
+ */
+void sched_yield();
+
+/**
+ * @brief Marks the current task dead and reschedules.
+ */
+void sched_exit();
+
+/**
+ * @brief Blocks the current task until an mtime deadline, and reschedules.
+ * The core runs other tasks meanwhile, or idles in wfi. The task is woken
+ * by a timer on the calling core, and queued there.
+ * @param deadline  Integer absolute mtime deadline
+ */
+void sched_sleep(uint64_t deadline);
+
+/**
+ * @brief Adopts the interrupted U-mode program (main) as a task and starts
+ *        the scheduler tick. Used when tasks are created from U-mode.
+ * main stays pinned to core 0, since __ustack0 is not mapped on core 1.
+ */
+void sched_adopt();
+
+/**
+ * @brief Returns nonzero if the scheduler is running on the calling core.
+ */
+uint32_t sched_running();
+
+/**
+ * @brief Returns the task running on the calling core, or 0 if the
+ *        scheduler is not running there.
+ */
+task_t *sched_current();
+
+/**
+ * @brief Returns the number of tasks, on either core, that have not exited,
+ *        sleeping ones included.
+ */
+uint32_t sched_live();
+
+/**
+ * @brief Returns context switch statistics of a core.
+ * @param core  Integer core number
+ */
+sched_stats_t *sched_stats(uint32_t core);
+
+/**
+ * @brief Called by `isr_mti` with the saved context of the interrupted code.
+ * Runs the timer service, then switches tasks if a reschedule is pending.
+ * @param sp    Integer stack pointer, pointing at the saved context_t
+ * @returns Integer stack pointer of the context to restore
+ */
+uint32_t sched_mti(uint32_t sp);
+
+/**
+ * @brief Restores the context at sp and returns from the trap.
+ * @param sp    Integer stack pointer, pointing at a context_t
+ */
+void context_restore(uint32_t sp);
+
+#endif
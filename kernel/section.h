@@ -0,0 +1,35 @@
+/**
+ * @file section.h
+ * @brief Placement of code and data on the trap path.
+ *
+ * XIP flash reads go through a 16 KB cache, and a miss stalls the core for
+ * a whole QSPI transfer. The vector table, the trap handlers in startup.S
+ * and anything marked here are linked into .time_critical instead, which
+ * _reset_handler copies to SRAM alongside .data. Mark functions that run on
+ * every interrupt or context switch; everything else stays in flash.
+ *
+ * @see util/memmap_template
+ * @author Herbie Rand
+ */
+
+#ifndef SECTION_H
+#define SECTION_H
+
+#ifdef HOST
+#define __time_critical
+#define __time_critical_data
+#else
+
+/**
+ * @brief Places a function definition in SRAM.
+ */
+#define __time_critical __attribute__((section(".time_critical.text")))
+
+/**
+ * @brief Places a variable definition in SRAM, e.g. a dispatch table.
+ * Do not mix const and non-const variables marked this way in one file.
+ */
+#define __time_critical_data __attribute__((section(".time_critical.data")))
+#endif
+
+#endif
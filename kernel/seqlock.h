@@ -0,0 +1,62 @@
+/**
+ * @file seqlock.h
+ * @brief Sequence lock, for publishing snapshots of small state to readers
+ *        that must never block the writer.
+ *
+ * The sequence is odd while a write is in progress. Readers copy the state
+ * between seqlock_read_begin and seqlock_read_retry, and try again if a
+ * write overlapped:
+ *
+ *     do {
+ *         seq = seqlock_read_begin(&lock);
+ *         copy = state;
+ *     } while (seqlock_read_retry(&lock, seq));
+ *
+ * Writers must be serialized by the caller. A reader that interrupts the
+ * writer on the same core retries until the writer resumes, so it must not
+ * loop on seqlock_read_retry from an ISR that preempted the writer.
+ *
+ * @author Herbie Rand
+ */
+
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include "types.h"
+
+typedef struct {
+    volatile uint32_t seq;
+} seqlock_t;
+
+static __inline void seqlock_init(seqlock_t *s) {
+    s->seq = 0;
+}
+
+static __inline void seqlock_write_begin(seqlock_t *s) {
+    __atomic_store_n(&s->seq, s->seq + 1, __ATOMIC_RELAXED);
+    // the odd sequence must be visible before any of the data writes
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static __inline void seqlock_write_end(seqlock_t *s) {
+    __atomic_store_n(&s->seq, s->seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @returns Integer sequence to pass to seqlock_read_retry
+ */
+static __inline uint32_t seqlock_read_begin(const seqlock_t *s) {
+    return __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @returns 1 if the copy since seqlock_read_begin may be torn, 0 otherwise
+ */
+static __inline uint32_t seqlock_read_retry(const seqlock_t *s,
+                                            uint32_t start) {
+    // the data reads must complete before the sequence is re-read
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return (start & 1) || __atomic_load_n(&s->seq, __ATOMIC_RELAXED) != start;
+}
+
+#endif
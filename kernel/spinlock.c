@@ -0,0 +1,169 @@
+/**
+ * @file spinlock.c
+ * @brief Implements spinlocks over SIO hardware spinlocks and ticket locks.
+ *
+ * Reading an SIO spinlock claims it and returns nonzero if it was free,
+ * writing any value releases it. Each access is a single bus transaction,
+ * so both cores may spin on the same lock.
+ *
+ * @author Herbie Rand
+ */
+
+#include "spinlock.h"
+#include "asm.h"
+#include "atomic.h"
+#include "riscv.h"
+#include "rp2350.h"
+#include "section.h"
+#include "types.h"
+
+/** @brief Bitmap of SIO spinlocks in use, see SIO_SPINLOCK_FIRST_SAFE */
+#ifdef BOARD_QEMU_VIRT
+// no SIO on the virt machine, every lock is a ticket lock
+static atomic_u32_t claimed = {MAX_UINT32};
+#else
+static atomic_u32_t claimed = {(1UL << SIO_SPINLOCK_FIRST_SAFE) - 1};
+#endif
+
+static __inline void _acquired(spinlock_t *l, uint32_t spins);
+static __inline void _releasing(spinlock_t *l);
+
+void spinlock_init(spinlock_t *l) {
+    uint32_t free;
+    uint32_t bit;
+
+    for (;;) {
+        free = ~atomic_u32_load(&claimed);
+        if (!free) {
+            spinlock_init_ticket(l);
+            return;
+        }
+        bit = 1UL << __builtin_ctz(free);
+        // the other core may have claimed the same one in between
+        if (!(atomic_u32_or(&claimed, bit) & bit)) {
+            break;
+        }
+    }
+
+    spinlock_init_ticket(l);
+    l->hw = (volatile uint32_t *)(SIO_SPINLOCK0 + 4 * __builtin_ctz(bit));
+    *l->hw = 0;
+}
+
+void spinlock_init_ticket(spinlock_t *l) {
+    l->hw = 0;
+    atomic_u32_store(&l->next, 0);
+    atomic_u32_store(&l->owner, 0);
+#ifdef SPINLOCK_STATS
+    l->stats.acquisitions = 0;
+    l->stats.contended = 0;
+    l->stats.spins = 0;
+    l->stats.max_hold = 0;
+#endif
+}
+
+void spinlock_deinit(spinlock_t *l) {
+    if (l->hw) {
+        atomic_u32_and(&claimed,
+                       ~(1UL << (((uint32_t)l->hw - SIO_SPINLOCK0) >> 2)));
+        l->hw = 0;
+    }
+}
+
+__time_critical void spinlock_lock(spinlock_t *l) {
+    uint32_t spins = 0;
+    uint32_t ticket;
+
+    if (l->hw) {
+        while (!*l->hw) {
+            spins++;
+        }
+    } else {
+        ticket = atomic_u32_add(&l->next, 1);
+        while (atomic_u32_load(&l->owner) != ticket) {
+            spins++;
+        }
+    }
+    // the critical section must not start before the lock is ours
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    _acquired(l, spins);
+}
+
+uint32_t spinlock_trylock(spinlock_t *l) {
+    uint32_t owner;
+
+    if (l->hw) {
+        if (!*l->hw) {
+            return 0;
+        }
+    } else {
+        // free only if no ticket is outstanding, i.e. next == owner
+        owner = atomic_u32_load(&l->owner);
+        if (!atomic_u32_cas(&l->next, &owner, owner + 1)) {
+            return 0;
+        }
+    }
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    _acquired(l, 0);
+    return 1;
+}
+
+__time_critical void spinlock_unlock(spinlock_t *l) {
+    _releasing(l);
+    // everything written in the critical section is visible before release
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    if (l->hw) {
+        *l->hw = 0;
+    } else {
+        // only the holder writes owner
+        atomic_u32_store(&l->owner, l->owner.v + 1);
+    }
+}
+
+uint32_t spinlock_lock_irqsave(spinlock_t *l) {
+    uint32_t mie = irq_save();
+
+    spinlock_lock(l);
+    return mie;
+}
+
+void spinlock_unlock_irqrestore(spinlock_t *l, uint32_t mie) {
+    spinlock_unlock(l);
+    irq_restore(mie);
+}
+
+spinlock_stats_t *spinlock_stats(spinlock_t *l) {
+#ifdef SPINLOCK_STATS
+    return &l->stats;
+#else
+    (void)l;
+    return 0;
+#endif
+}
+
+// Statistics are only written by the holder, so they need no atomics
+static __inline void _acquired(spinlock_t *l, uint32_t spins) {
+#ifdef SPINLOCK_STATS
+    l->stats.acquisitions++;
+    if (spins) {
+        l->stats.contended++;
+        l->stats.spins += spins;
+    }
+    l->stamp = csr_read(mcycle);
+#else
+    (void)l;
+    (void)spins;
+#endif
+}
+
+static __inline void _releasing(spinlock_t *l) {
+#ifdef SPINLOCK_STATS
+    uint32_t held = csr_read(mcycle) - l->stamp;
+
+    if (held > l->stats.max_hold) {
+        l->stats.max_hold = held;
+    }
+#else
+    (void)l;
+#endif
+}
@@ -0,0 +1,114 @@
+/**
+ * @file spinlock.h
+ * @brief Spinlocks, for short critical sections shared between cores.
+ *
+ * spinlock_init hands out one of the SIO hardware spinlocks while any are
+ * free, and falls back to a ticket lock on the A extension otherwise. Both
+ * kinds are used the same way. Ticket locks are fair: waiters get the lock
+ * in arrival order. A zeroed spinlock_t is an unlocked ticket lock, so
+ * static locks work without spinlock_init.
+ *
+ * A lock that is also taken by an ISR must be taken with interrupts off
+ * everywhere else, via spinlock_lock_irqsave, or the ISR may spin forever on
+ * a lock held by the code it interrupted.
+ *
+ * Building with SPINLOCK_STATS=1 keeps per-lock statistics, see
+ * spinlock_stats_t. Otherwise they are compiled out.
+ *
+ * @author Herbie Rand
+ */
+
+#ifndef SPINLOCK_H
+#define SPINLOCK_H
+
+#include "atomic.h"
+#include "types.h"
+
+/** @brief Lock statistics, in mcycle where applicable */
+typedef struct {
+    uint32_t acquisitions;
+    /** @brief Acquisitions that had to wait */
+    uint32_t contended;
+    /** @brief Total wait loop iterations */
+    uint32_t spins;
+    /** @brief Longest time the lock was held */
+    uint32_t max_hold;
+} spinlock_stats_t;
+
+typedef struct {
+    /** @brief SIO spinlock register, or 0 for a ticket lock */
+    volatile uint32_t *hw;
+    /** @brief Next ticket to hand out */
+    atomic_u32_t next;
+    /** @brief Ticket currently holding the lock */
+    atomic_u32_t owner;
+#ifdef SPINLOCK_STATS
+    spinlock_stats_t stats;
+    /** @brief mcycle at acquisition, only written by the holder */
+    uint32_t stamp;
+#endif
+} spinlock_t;
+
+/**
+ * @brief Initializes an unlocked spinlock, backed by a free SIO hardware
+ *        spinlock if there is one.
+ * @param l     Lock
+ */
+void spinlock_init(spinlock_t *l);
+
+/**
+ * @brief Initializes an unlocked ticket lock. Suitable for static locks
+ *        that should not use up a hardware spinlock.
+ * @param l     Lock
+ */
+void spinlock_init_ticket(spinlock_t *l);
+
+/**
+ * @brief Releases the hardware spinlock backing a lock, if any. The lock
+ *        must not be held, and must be initialized again before use.
+ * @param l     Lock
+ */
+void spinlock_deinit(spinlock_t *l);
+
+/**
+ * @brief Spins until the lock is acquired.
+ * @param l     Lock
+ */
+void spinlock_lock(spinlock_t *l);
+
+/**
+ * @brief Acquires the lock if it is free, without spinning.
+ * @param l     Lock
+ * @returns 1 if the lock was acquired, 0 otherwise
+ */
+uint32_t spinlock_trylock(spinlock_t *l);
+
+/**
+ * @brief Releases the lock. Must be called by the holder.
+ * @param l     Lock
+ */
+void spinlock_unlock(spinlock_t *l);
+
+/**
+ * @brief Disables interrupts, then spins until the lock is acquired.
+ * @param l     Lock
+ * @returns Integer previous value of mstatus.MIE, for
+ *          spinlock_unlock_irqrestore
+ */
+uint32_t spinlock_lock_irqsave(spinlock_t *l);
+
+/**
+ * @brief Releases the lock, then restores interrupts.
+ * @param l     Lock
+ * @param mie   Integer value returned by spinlock_lock_irqsave
+ */
+void spinlock_unlock_irqrestore(spinlock_t *l, uint32_t mie);
+
+/**
+ * @brief Returns the lock's statistics, or 0 if built without
+ *        SPINLOCK_STATS.
+ * @param l     Lock
+ */
+spinlock_stats_t *spinlock_stats(spinlock_t *l);
+
+#endif
@@ -1,31 +1,42 @@
 #include "syscall.h"
 #include "asm.h"
 #include "gpio.h"
+#include "mtime.h"
+#include "riscv.h"
 #include "rp2350.h"
+#include "runtime.h"
+#include "sched.h"
+#include "section.h"
 #include "sys.h"
+#include "timer.h"
 #include "types.h"
 
 #define LED_PIN 25
 
 static uint8_t led_init = 0;
 
-static void (*syscall_table[])(exception_frame_t *) = {
+/** @brief Wakes the core from _nap */
+static ktimer_t nap[NUM_CORES];
+
+static void _nap(uint64_t deadline);
+static void _nap_done(void *arg);
+
+__time_critical_data const syscall_t syscall_table[SYSCALL_COUNT] = {
     [SYS_LED_ON] sys_led_on,
     [SYS_LED_OFF] sys_led_off,
-    [SYS_SPIN_MS] sys_spin_ms,
+    [SYS_SPIN_MS] (syscall_t)sys_spin_ms,
+    [SYS_TASK_CREATE] (syscall_t)sys_task_create,
+    [SYS_TASK_YIELD] sys_task_yield,
+    [SYS_TASK_EXIT] sys_task_exit,
+    [SYS_NULL] sys_null,
+    [SYS_USER_RETURN] (syscall_t)sys_user_return,
+    [SYS_URING_SETUP] (syscall_t)sys_uring_setup,
+    [SYS_URING_ENTER] (syscall_t)sys_uring_enter,
+    [SYS_URING_TEARDOWN] (syscall_t)sys_uring_teardown,
+    [SYS_SLEEP_US] (syscall_t)sys_sleep_us,
 };
 
-void isr_env_umode_exc(exception_frame_t *sf) {
-    if (sf->a7 >= SYSCALL_COUNT) {
-        // should never reach here
-        breakpoint();
-    }
-    syscall_table[sf->a7](sf);
-    inc_mepc();
-}
-
-void sys_led_on(exception_frame_t *sf) {
-    (void)sf;
+void sys_led_on() {
     if (!led_init) {
         gpio_init(LED_PIN);
         led_init = 1;
@@ -33,16 +44,68 @@ void sys_led_on(exception_frame_t *sf) {
     gpio_set(LED_PIN);
 }
 
-void sys_led_off(exception_frame_t *sf) {
-    (void)sf;
+void sys_led_off() {
     gpio_clr(LED_PIN);
 }
 
-void sys_spin_ms(exception_frame_t *sf) {
-    uint32_t ms = (uint32_t)sf->a0;
-    while (ms--) {
-        // NOTE: inexact
-        for (uint32_t j = 0; j < 17000; j++)
-            ;
+void sys_spin_ms(uint32_t ms) {
+    spin_ticks(us_to_ticks((uint64_t)ms * 1000));
+}
+
+void sys_sleep_us(uint32_t us) {
+    uint64_t deadline = mtime_read() + us_to_ticks(us);
+
+    if (sched_running()) {
+        sched_sleep(deadline);
+    } else {
+        _nap(deadline);
+    }
+}
+
+int32_t sys_task_create(void (*entry)(), uint32_t prio) {
+    // the first task created from U-mode turns main into a task
+    if (!sched_running()) {
+        sched_adopt();
     }
+    return sched_spawn(entry, prio);
+}
+
+void sys_task_yield() {
+    sched_yield();
+}
+
+void sys_task_exit() {
+    // its rings would otherwise be polled for good
+    uring_task_exit(sched_current());
+    sched_exit();
+}
+
+void sys_null() {
+}
+
+void sys_user_return(uint32_t a0, uint32_t a1) {
+    user_call_return(a0, a1);
+}
+
+// Waits for the deadline with interrupts enabled. They trap on top of this
+// syscall, so the trap state it returns through is kept aside.
+static void _nap(uint64_t deadline) {
+    uint32_t epc = csr_read(mepc);
+    uint32_t status = csr_read(mstatus);
+    volatile uint32_t done = 0;
+    ktimer_t *t = &nap[this_cpu()->id];
+
+    timer_start(t, deadline, _nap_done, (void *)&done);
+    set_mie(MTI_MASK);
+    while (!done) {
+        wfi();
+        irq_restore(MIE_MASK);
+        irq_save();
+    }
+    csr_write(mepc, epc);
+    csr_write(mstatus, status);
+}
+
+static void _nap_done(void *arg) {
+    *(volatile uint32_t *)arg = 1;
 }
@@ -4,9 +4,12 @@
 #ifndef SYSCALL_H
 #define SYSCALL_H
 
+#include "sched.h"
+#include "sys.h"
 #include "types.h"
+#include "uring.h"
 
-/** @brief Exception frame, pushed onto the stack during ecall */
+/** @brief Exception frame, pushed onto the stack by isr_exc */
 typedef struct {
     uint32_t a0;
     uint32_t a1;
@@ -26,27 +29,100 @@ typedef struct {
 } exception_frame_t;
 
 /**
- * @brief Overrides weak umode ecall service routine.
- * @param exception_frame_t containing syscall args
+ * @brief Syscall handler, called straight from the ecall fast path
+ *        (isr_ecall in startup.S). Arguments arrive in a0-a5 as passed to the
+ *        user stub, so handlers are declared with their real parameters, and
+ *        results are returned in a0 (a0/a1 for 64-bit results).
  */
-void isr_env_umode_exc(exception_frame_t *);
+typedef void (*syscall_t)();
+
+/** @brief Handlers indexed by syscall number, see sys.h */
+extern const syscall_t syscall_table[SYSCALL_COUNT];
 
 /**
  * @brief Uses GPIO to turn on the LED.
- * @param exception_frame_t containing syscall args
  */
-void sys_led_on(exception_frame_t *);
+void sys_led_on();
 
 /**
  * @brief Uses GPIO to turn off the LED.
- * @param exception_frame_t containing syscall args
  */
-void sys_led_off(exception_frame_t *);
+void sys_led_off();
+
+/**
+ * @brief Spins roughly specified number of milliseconds, with interrupts
+ *        masked throughout. See sys_sleep_us.
+ * @param ms    Integer milliseconds
+ */
+void sys_spin_ms(uint32_t ms);
+
+/**
+ * @brief Sleeps for at least the given time, without holding off
+ *        interrupts. A task blocks and the core runs other tasks, see
+ *        sched_sleep. Without the scheduler, the core waits in wfi and
+ *        takes interrupts as they come.
+ * @param us    Integer microseconds
+ */
+void sys_sleep_us(uint32_t us);
+
+/**
+ * @brief Creates a task from U-mode, adopting the caller as a task if the
+ *        scheduler is not yet running.
+ * @param entry Task entry point
+ * @param prio  Integer priority
+ * @returns Integer task id, or -1 if no slot is free
+ */
+int32_t sys_task_create(void (*entry)(), uint32_t prio);
+
+/**
+ * @brief Yields the CPU to another ready task.
+ */
+void sys_task_yield();
+
+/**
+ * @brief Terminates the calling task.
+ */
+void sys_task_exit();
+
+/**
+ * @brief Does nothing, for measuring the syscall round trip.
+ */
+void sys_null();
+
+/**
+ * @brief Returns to the M-mode caller of `user_call`, see asm.h.
+ * @param a0    Integer first result
+ * @param a1    Integer second result
+ */
+void sys_user_return(uint32_t a0, uint32_t a1);
+
+/**
+ * @brief Sets up an empty ring and, if poll_us is nonzero, has the calling
+ *        core drain it every poll_us from a timer, in place of the one it
+ *        polled before, see uring.c.
+ * @param poll_us   Integer polling period in microseconds, or 0
+ * @returns The ring, or 0 if all URING_MAX are in use
+ */
+uring_t *sys_uring_setup(uint32_t poll_us);
+
+/**
+ * @brief Stops draining and polling a ring, and frees it for reuse.
+ * @param r     Ring set up with sys_uring_setup
+ * @returns 0, or -1 if r is not a ring in use
+ */
+int32_t sys_uring_teardown(uring_t *r);
+
+/**
+ * @brief Runs the queued SQEs of a ring, as long as its CQ has room.
+ * @param r     Ring set up with sys_uring_setup
+ * @returns Integer number of SQEs completed
+ */
+uint32_t sys_uring_enter(uring_t *r);
 
 /**
- * @brief Spins roughly specified number of milliseconds.
- * @param exception_frame_t containing syscall args
+ * @brief Tears down every ring a task set up, as it exits.
+ * @param t     Exiting task
  */
-void sys_spin_ms(exception_frame_t *);
+void uring_task_exit(const task_t *t);
 
 #endif
@@ -0,0 +1,318 @@
+/**
+ * @file timer.c
+ * @brief Implements the hierarchical timer wheel.
+ * @author Herbie Rand
+ */
+
+#include "timer.h"
+#include "asm.h"
+#include "mtime.h"
+#include "runtime.h"
+#include "section.h"
+#include "types.h"
+
+#define SLOT_MASK    (TIMER_WHEEL_SLOTS - 1)
+#define WHEEL_RANGE  (1UL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS))
+#define GRANULE_NONE MAX_UINT64
+
+void isr_mtimer_irq();
+
+typedef struct {
+    ktimer_t *slot[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    /** @brief Bitmap of non-empty slots per level */
+    uint32_t map[TIMER_WHEEL_LEVELS][2];
+    /** @brief Current granule, all earlier granules have been processed */
+    uint64_t clk;
+    /** @brief Deadline currently programmed in MTIMECMP */
+    uint64_t armed;
+    uint32_t init;
+} wheel_t;
+
+/** @brief One wheel per core, each driven by that core's MTIMECMP */
+static wheel_t wheels[NUM_CORES];
+
+static __inline wheel_t *_wheel();
+static void _add(ktimer_t *t);
+static void _remove(ktimer_t *t);
+static ktimer_t *_take(uint32_t level, uint32_t slot);
+static uint32_t _next_slot(uint32_t *map, uint32_t from);
+static uint64_t _next(uint64_t *deadline);
+static void _cascade();
+static uint32_t _expire(uint64_t now);
+static void _arm(uint64_t deadline);
+
+void timer_init() {
+    wheel_t *w = _wheel();
+
+    if (w->init) {
+        return;
+    }
+    w->clk = mtime_read() >> TIMER_GRANULE_SHIFT;
+    w->armed = 0;
+    w->init = 1;
+    _arm(TIMER_NEVER);
+}
+
+void timer_start(ktimer_t *t, uint64_t deadline, void (*fn)(void *),
+                 void *arg) {
+    wheel_t *w = _wheel();
+    uint32_t mie = irq_save();
+
+    if (!w->init) {
+        timer_init();
+    }
+    if (t->active) {
+        _remove(t);
+    }
+    t->deadline = deadline;
+    t->fn = fn;
+    t->arg = arg;
+    _add(t);
+
+    // the new deadline is never later than its own cascade point, so arming
+    // it directly is safe; timer_irq catches up on any skipped cascades
+    if (deadline < w->armed) {
+        _arm(deadline);
+    }
+    irq_restore(mie);
+}
+
+void timer_cancel(ktimer_t *t) {
+    uint32_t mie = irq_save();
+
+    // MTIMECMP is left as is, a spurious interrupt just re-arms it
+    if (t->active) {
+        _remove(t);
+    }
+    irq_restore(mie);
+}
+
+void timer_kick() {
+    wheel_t *w = _wheel();
+
+    w->armed = 0;
+    mtimer_set(0);
+}
+
+__time_critical void timer_irq() {
+    wheel_t *w = _wheel();
+    uint64_t now;
+    uint64_t g;
+    uint64_t next;
+    uint64_t deadline;
+
+    if (!w->init) {
+        isr_mtimer_irq();
+        return;
+    }
+
+    now = mtime_read();
+    g = now >> TIMER_GRANULE_SHIFT;
+
+    // jump straight to the next granule with work, so idle time is free
+    for (;;) {
+        next = _next(&deadline);
+        if (next > g) {
+            break;
+        }
+        if (next > w->clk) {
+            w->clk = next;
+            _cascade();
+        } else if (!_expire(now)) {
+            // remaining timers in the current granule are not yet due
+            _next(&deadline);
+            break;
+        }
+    }
+    _arm(deadline);
+}
+
+__time_critical static void _add(ktimer_t *t) {
+    wheel_t *w = _wheel();
+    uint64_t g = t->deadline >> TIMER_GRANULE_SHIFT;
+    uint32_t delta;
+    uint32_t level = 0;
+    ktimer_t **head;
+
+    if (g < w->clk) {
+        g = w->clk;
+    }
+    // timers beyond the wheel are parked in the last slot of the top level,
+    // and re-inserted from their real deadline when it cascades
+    if (g - w->clk >= WHEEL_RANGE) {
+        g = w->clk + WHEEL_RANGE - 1;
+    }
+    delta = (uint32_t)(g - w->clk);
+
+    while (delta >= TIMER_WHEEL_SLOTS) {
+        delta >>= TIMER_WHEEL_BITS;
+        g >>= TIMER_WHEEL_BITS;
+        level++;
+    }
+
+    t->level = level;
+    t->slot = g & SLOT_MASK;
+    t->active = 1;
+
+    head = &w->slot[level][t->slot];
+    t->next = *head;
+    t->pprev = head;
+    if (*head) {
+        (*head)->pprev = &t->next;
+    }
+    *head = t;
+    w->map[level][t->slot >> 5] |= (1UL << (t->slot & 31));
+}
+
+// Unlinks a timer, either from its slot or from a list returned by _take
+__time_critical static void _remove(ktimer_t *t) {
+    wheel_t *w = _wheel();
+
+    *t->pprev = t->next;
+    if (t->next) {
+        t->next->pprev = t->pprev;
+    }
+    if (!w->slot[t->level][t->slot]) {
+        w->map[t->level][t->slot >> 5] &= ~(1UL << (t->slot & 31));
+    }
+    t->active = 0;
+}
+
+// Empties a slot. The returned list head must be passed on to a local
+// variable whose address the first timer's pprev then points to.
+__time_critical static ktimer_t *_take(uint32_t level, uint32_t slot) {
+    wheel_t *w = _wheel();
+    ktimer_t *list = w->slot[level][slot];
+
+    w->slot[level][slot] = 0;
+    w->map[level][slot >> 5] &= ~(1UL << (slot & 31));
+    return list;
+}
+
+// Returns the distance from `from` to the next non-empty slot, wrapping
+// around the level, or TIMER_WHEEL_SLOTS if the level is empty.
+__time_critical static uint32_t _next_slot(uint32_t *map, uint32_t from) {
+    uint32_t word = from >> 5;
+    uint32_t bit = from & 31;
+    uint32_t m;
+
+    m = map[word] & (MAX_UINT32 << bit);
+    if (m) {
+        return (word << 5) + __builtin_ctz(m) - from;
+    }
+    m = map[word ^ 1];
+    if (m) {
+        return (((word ^ 1) << 5) + __builtin_ctz(m) - from) & SLOT_MASK;
+    }
+    m = map[word] & ~(MAX_UINT32 << bit);
+    if (m) {
+        return ((word << 5) + __builtin_ctz(m) - from) & SLOT_MASK;
+    }
+    return TIMER_WHEEL_SLOTS;
+}
+
+// Returns the earliest granule at which a timer expires or a slot must be
+// cascaded, and the mtime deadline MTIMECMP should be armed with for it.
+__time_critical static uint64_t _next(uint64_t *deadline) {
+    wheel_t *w = _wheel();
+    uint64_t next = GRANULE_NONE;
+    uint64_t g = w->clk;
+    uint64_t b;
+    uint32_t off;
+    uint32_t level;
+    ktimer_t *t;
+
+    *deadline = TIMER_NEVER;
+
+    off = _next_slot(w->map[0], g & SLOT_MASK);
+    if (off < TIMER_WHEEL_SLOTS) {
+        next = g + off;
+        for (t = w->slot[0][next & SLOT_MASK]; t; t = t->next) {
+            if (t->deadline < *deadline) {
+                *deadline = t->deadline;
+            }
+        }
+    }
+
+    for (level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+        g >>= TIMER_WHEEL_BITS;
+        // the current slot was cascaded when we entered it, anything
+        // there now belongs to the next rotation, so search after it
+        off = _next_slot(w->map[level], (g + 1) & SLOT_MASK);
+        if (off == TIMER_WHEEL_SLOTS) {
+            continue;
+        }
+        b = g + off + 1;
+        for (uint32_t i = 0; i < level; i++) {
+            b <<= TIMER_WHEEL_BITS;
+        }
+        if (b < next) {
+            next = b;
+        }
+        if ((b << TIMER_GRANULE_SHIFT) < *deadline) {
+            *deadline = b << TIMER_GRANULE_SHIFT;
+        }
+    }
+    return next;
+}
+
+// Moves timers down from every level whose slot boundary clk now sits on
+__time_critical static void _cascade() {
+    wheel_t *w = _wheel();
+    uint64_t g = w->clk;
+    ktimer_t *list;
+    ktimer_t *t;
+
+    for (uint32_t level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+        if (g & SLOT_MASK) {
+            return;
+        }
+        g >>= TIMER_WHEEL_BITS;
+        list = _take(level, g & SLOT_MASK);
+        if (list) {
+            list->pprev = &list;
+        }
+        while (list) {
+            t = list;
+            _remove(t);
+            _add(t);
+        }
+    }
+}
+
+// Fires due timers in the current slot. Callbacks may start or cancel any
+// timer, including ones still on the local list.
+__time_critical static uint32_t _expire(uint64_t now) {
+    wheel_t *w = _wheel();
+    uint32_t fired = 0;
+    ktimer_t *list = _take(0, w->clk & SLOT_MASK);
+    ktimer_t *t;
+
+    if (list) {
+        list->pprev = &list;
+    }
+    while (list) {
+        t = list;
+        _remove(t);
+        if (t->deadline <= now) {
+            t->fn(t->arg);
+            fired++;
+        } else {
+            _add(t);
+        }
+    }
+    return fired;
+}
+
+__time_critical static void _arm(uint64_t deadline) {
+    wheel_t *w = _wheel();
+
+    if (deadline != w->armed) {
+        w->armed = deadline;
+        mtimer_set(deadline);
+    }
+}
+
+static __inline wheel_t *_wheel() {
+    return &wheels[this_cpu()->id];
+}
@@ -0,0 +1,84 @@
+/**
+ * @file timer.h
+ * @brief Software timer service on top of the free-running mtime counter.
+ *
+ * Timers have absolute 64-bit mtime deadlines and live in a hierarchical
+ * timer wheel: TIMER_WHEEL_LEVELS levels of TIMER_WHEEL_SLOTS slots, where a
+ * level 0 slot spans one granule of 2^TIMER_GRANULE_SHIFT mtime ticks and
+ * each following level spans TIMER_WHEEL_SLOTS times the previous one.
+ * Starting and cancelling a timer is O(1). Timers are cascaded down one
+ * level at a time as their deadline approaches, so expiry is O(1) amortized.
+ * MTIMECMP is always armed for the nearest expiry or cascade.
+ *
+ * Each core has its own wheel, driven by its own MTIMECMP, and a timer fires
+ * on the core that started it. A timer must only be re-started or cancelled
+ * on that core.
+ *
+ * @author Herbie Rand
+ */
+
+#ifndef TIMER_H
+#define TIMER_H
+
+#include "types.h"
+
+#define TIMER_GRANULE_SHIFT 2
+#define TIMER_WHEEL_BITS    6
+#define TIMER_WHEEL_SLOTS   (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS  4
+
+/** @brief Deadline that never expires */
+#define TIMER_NEVER MAX_UINT64
+
+/** @brief Software timer, owned by the caller */
+typedef struct ktimer {
+    /** @brief Absolute mtime deadline */
+    uint64_t deadline;
+    /** @brief Called from the mtimer interrupt once the deadline passes */
+    void (*fn)(void *);
+    /** @brief Argument passed to fn */
+    void *arg;
+    struct ktimer *next;
+    struct ktimer **pprev;
+    uint8_t level;
+    uint8_t slot;
+    uint8_t active;
+} ktimer_t;
+
+/**
+ * @brief Initializes the timer wheel at the current mtime.
+ * Safe to call more than once.
+ */
+void timer_init();
+
+/**
+ * @brief Arms (or re-arms) a timer for an absolute mtime deadline.
+ * May be called from a timer callback, e.g. to implement periodic timers.
+ * @param t         Timer to arm
+ * @param deadline  Integer absolute mtime deadline
+ * @param fn        Callback, called in interrupt context
+ * @param arg       Argument passed to the callback
+ */
+void timer_start(ktimer_t *t, uint64_t deadline, void (*fn)(void *),
+                 void *arg);
+
+/**
+ * @brief Disarms a timer. Does nothing if the timer is not armed.
+ * @param t     Timer to disarm
+ */
+void timer_cancel(ktimer_t *t);
+
+/**
+ * @brief Forces the mtimer interrupt to fire as soon as interrupts are
+ *        enabled, without expiring any timer.
+ */
+void timer_kick();
+
+/**
+ * @brief Expires due timers and re-arms MTIMECMP. Called by `isr_mti`.
+ * Calls `isr_mtimer_irq` directly if the timer service was never
+ * initialized, so MTIMECMP may still be driven by hand.
+ */
+void timer_irq();
+
+#endif
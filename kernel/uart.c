@@ -1,12 +1,42 @@
 #include "uart.h"
 #include "asm.h"
+#include "dma.h"
 #include "gpio.h"
 #include "resets.h"
+#include "riscv.h"
 #include "rp2350.h"
+#include "spinlock.h"
 
 #define BAUDRATE 115200
 
+#define TX_MASK (UART_TX_BUFSIZE - 1)
+#define RX_MASK (UART_RX_BUFSIZE - 1)
+
 static __inline void _uart_set_default_format();
+static void _putc(char c);
+static char _getc();
+static void _tx_fill();
+static void _rx_drain();
+static void _idle(uint32_t mie);
+
+/**
+ * @brief Rings for interrupt-driven mode. Indices are free-running, so
+ *        head - tail is the fill level. Only touched with interrupts off and
+ *        the lock held, so both cores may read and write.
+ */
+static struct {
+    char tx[UART_TX_BUFSIZE];
+    char rx[UART_RX_BUFSIZE];
+    volatile uint32_t txhead;
+    volatile uint32_t txtail;
+    volatile uint32_t rxhead;
+    volatile uint32_t rxtail;
+    volatile uint32_t dropped;
+    uint32_t irq;
+    /** @brief Core that takes UART0_IRQ */
+    uint32_t core;
+    spinlock_t lock;
+} ring;
 
 void uart_init() {
     // set uart functions on GPIO0 and GPIO1, and remove pad isolation control
@@ -24,21 +54,145 @@ void uart_init() {
     // enable uart, tx, rx
     AT(UART0_UARTCR) = (UARTCR_UARTEN | UARTCR_TXE | UARTCR_RXE);
 
-    // TODO: enable FIFOs (UARTLCR_H)
+    // NOTE: FIFOs are enabled by the default format (UARTLCR_H.FEN)
 
-    // TODO: enable DMA requests
+    // DREQs only pace DMA channels that select them, see uart_write_dma
+    AT(UART0_UARTDMACR) = UARTDMACR_TXDMAE | UARTDMACR_RXDMAE;
 
     (void)baud;
 }
 
+void uart_irq_enable(uint32_t rxlevel, uint32_t txlevel) {
+    if (rxlevel > UARTIFLS_7_8 || txlevel > UARTIFLS_7_8) {
+        breakpoint();
+    }
+
+    AT(UART0_UARTIFLS) = (rxlevel << UARTIFLS_RXSEL_SHIFT) | txlevel;
+    AT(UART0_UARTICR) = 0x7ff;
+    // TX is only unmasked while the TX ring has data, see _tx_fill
+    AT(UART0_UARTIMSC) = UARTINT_RX | UARTINT_RT;
+    ring.core = csr_read(mhartid);
+    ring.irq = 1;
+    irq_enable(UART0_IRQ);
+}
+
 void uart_putc(char c) {
+    if (!ring.irq) {
+        _putc(c);
+        return;
+    }
+    uart_write(&c, 1);
+}
+
+char uart_getc() {
+    char c;
+
+    if (!ring.irq) {
+        return _getc();
+    }
+    uart_read(&c, 1);
+    return c;
+}
+
+void uart_write(const char *buf, uint32_t n) {
+    uint32_t mie;
+
+    if (!ring.irq) {
+        while (n--) {
+            _putc(*buf++);
+        }
+        return;
+    }
+
+    mie = spinlock_lock_irqsave(&ring.lock);
+    while (n) {
+        while (n && ring.txhead - ring.txtail < UART_TX_BUFSIZE) {
+            ring.tx[ring.txhead++ & TX_MASK] = *buf++;
+            n--;
+        }
+        _tx_fill();
+        if (n) {
+            _idle(mie);
+        }
+    }
+    spinlock_unlock_irqrestore(&ring.lock, mie);
+}
+
+uint32_t uart_read(char *buf, uint32_t n) {
+    uint32_t mie;
+    uint32_t i = 0;
+
+    if (!ring.irq) {
+        buf[0] = _getc();
+        return 1;
+    }
+
+    mie = spinlock_lock_irqsave(&ring.lock);
+    while (ring.rxhead == ring.rxtail) {
+        _idle(mie);
+    }
+    while (i < n && ring.rxtail != ring.rxhead) {
+        buf[i++] = ring.rx[ring.rxtail++ & RX_MASK];
+    }
+    spinlock_unlock_irqrestore(&ring.lock, mie);
+    return i;
+}
+
+void uart_flush() {
+    uint32_t mie = spinlock_lock_irqsave(&ring.lock);
+
+    while (ring.txhead != ring.txtail) {
+        _idle(mie);
+    }
+    spinlock_unlock_irqrestore(&ring.lock, mie);
+
+    while (AT(UART0_UARTFR) & UARTFR_BUSY)
+        ;
+}
+
+int32_t uart_write_dma(const char *buf, uint32_t n, void (*done)(void *),
+                       void *arg) {
+    return dma_to_periph(UART0_UARTDR, buf, n, DMA_SIZE_8, DREQ_UART0_TX,
+                         done, arg);
+}
+
+int32_t uart_read_dma(char *buf, uint32_t n, void (*done)(void *),
+                      void *arg) {
+    return dma_from_periph(buf, UART0_UARTDR, n, DMA_SIZE_8, DREQ_UART0_RX,
+                           done, arg);
+}
+
+uint32_t uart_rx_dropped() {
+    return ring.dropped;
+}
+
+/**
+ * @brief UART0 interrupt handler, overrides the weak definition in startup.S.
+ */
+void isr_irq33() {
+    // isr_mei re-enables preemption, but other handlers may log to the UART
+    uint32_t mie = spinlock_lock_irqsave(&ring.lock);
+    uint32_t mis = AT(UART0_UARTMIS);
+
+    // draining the FIFO also deasserts the RX timeout
+    if (mis & (UARTINT_RX | UARTINT_RT)) {
+        _rx_drain();
+    }
+    if (mis & UARTINT_TX) {
+        _tx_fill();
+    }
+    AT(UART0_UARTICR) = mis;
+    spinlock_unlock_irqrestore(&ring.lock, mie);
+}
+
+static void _putc(char c) {
     // wait for TX FIFO to have space
     while (AT(UART0_UARTFR) & UARTFR_TXFF)
         ;
     AT(UART0_UARTDR) = c;
 }
 
-char uart_getc() {
+static char _getc() {
     // wait for RX FIFO to have a byte
     while (AT(UART0_UARTFR) & UARTFR_RXFE)
         ;
@@ -46,6 +200,55 @@ char uart_getc() {
     return AT(UART0_UARTDR) & 0xff;
 }
 
+// Moves bytes from the TX ring into the FIFO. The TX interrupt only fires
+// when the FIFO level drops through the trigger level, so it is unmasked
+// only while the ring still has bytes the FIFO could not take.
+static void _tx_fill() {
+    while (ring.txtail != ring.txhead &&
+           !(AT(UART0_UARTFR) & UARTFR_TXFF)) {
+        AT(UART0_UARTDR) = ring.tx[ring.txtail++ & TX_MASK];
+    }
+    if (ring.txtail == ring.txhead) {
+        AT(UART0_UARTIMSC + ATOMIC_BITCLR_OFFSET) = UARTINT_TX;
+    } else {
+        AT(UART0_UARTIMSC + ATOMIC_BITSET_OFFSET) = UARTINT_TX;
+    }
+}
+
+static void _rx_drain() {
+    uint32_t dr;
+
+    while (!(AT(UART0_UARTFR) & UARTFR_RXFE)) {
+        dr = AT(UART0_UARTDR);
+        if ((dr & UARTDR_ERR_MASK) ||
+            ring.rxhead - ring.rxtail == UART_RX_BUFSIZE) {
+            ring.dropped++;
+            continue;
+        }
+        ring.rx[ring.rxhead++ & RX_MASK] = dr & 0xff;
+    }
+}
+
+// Waits for the UART0 IRQ to make progress. Called with interrupts off and
+// the lock held: wfi still wakes on a pending interrupt, which is then taken
+// in the window below, with the lock dropped. On the core that does not take
+// the IRQ, just lets the handler in. If the caller had interrupts off to
+// begin with, polls instead.
+static void _idle(uint32_t mie) {
+    if (!mie) {
+        _tx_fill();
+        _rx_drain();
+        return;
+    }
+    spinlock_unlock(&ring.lock);
+    if (csr_read(mhartid) == ring.core) {
+        wfi();
+        irq_restore(mie);
+        irq_save();
+    }
+    spinlock_lock(&ring.lock);
+}
+
 #define UART_CLOCK_HZ 150000000
 
 // adapted from datasheet 12.1.7.1
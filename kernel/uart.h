@@ -1,6 +1,18 @@
 /**
  * @file uart.h
  * @brief UART functions, currently uses UART instance 0 only.
+ *
+ * The driver starts out polled: every call busy-waits on UARTFR. After
+ * `uart_irq_enable`, it is driven by the UART0 IRQ instead. Writers then only
+ * enqueue into a TX ring and return, and readers sleep (wfi) until the RX
+ * ring has data. The RX ring is filled when the RX FIFO reaches its trigger
+ * level, or by the RX timeout once the line has been idle for 32 bit periods,
+ * so bursts are coalesced into few interrupts.
+ *
+ * Both cores may use the driver. UART0_IRQ is taken by the core that called
+ * `uart_irq_enable`; on the other core, waiting callers spin instead of
+ * sleeping.
+ *
  * @author Herbie Rand
  */
 #ifndef UART_H
@@ -8,6 +20,11 @@
 
 #include "types.h"
 
+/** @brief TX ring size in bytes, a power of two */
+#define UART_TX_BUFSIZE 512
+/** @brief RX ring size in bytes, a power of two */
+#define UART_RX_BUFSIZE 256
+
 /**
  * @brief Initializes UART0 on the provided GPIO pins.
  *
@@ -16,6 +33,13 @@
  */
 void uart_init();
 
+/**
+ * @brief Switches UART0 to interrupt-driven mode.
+ * @param rxlevel   RX FIFO trigger level, one of UARTIFLS_<X> in rp2350.h
+ * @param txlevel   TX FIFO trigger level, one of UARTIFLS_<X> in rp2350.h
+ */
+void uart_irq_enable(uint32_t rxlevel, uint32_t txlevel);
+
 /**
  * @brief Writes a single character to the UART0 transmit buffer.
  * @param c     Byte to transmit
@@ -28,6 +52,78 @@ void uart_putc(char c);
  */
 char uart_getc();
 
+/**
+ * @brief Writes bytes to UART0. In interrupt-driven mode, waits only while
+ *        the TX ring is full.
+ * @param buf   Bytes to transmit
+ * @param n     Integer number of bytes
+ */
+void uart_write(const char *buf, uint32_t n);
+
+/**
+ * @brief Writes a NUL-terminated string to UART0, like uart_write.
+ * @param s     String to transmit, without its terminator
+ */
+void uart_puts(const char *s);
+
+/**
+ * @brief Writes an integer to UART0 in decimal, like uart_write.
+ * @param v     Integer value
+ */
+void uart_putu(uint32_t v);
+
+/**
+ * @brief Writes a 64-bit integer to UART0 in decimal, like uart_write,
+ *        without 64-bit division.
+ * @param v     Integer value
+ */
+void uart_putu64(uint64_t v);
+
+/**
+ * @brief Reads at least one byte from UART0, and at most n.
+ * @param buf   Buffer for received bytes
+ * @param n     Integer buffer size, must be nonzero
+ * @returns Integer number of bytes read
+ */
+uint32_t uart_read(char *buf, uint32_t n);
+
+/**
+ * @brief Waits until every byte written so far has left the UART.
+ */
+void uart_flush();
+
+/**
+ * @brief Transmits a buffer by DMA, paced by the UART0 TX DREQ.
+ * Do not mix with uart_write while the transfer is in flight.
+ * @param buf   Bytes to transmit, valid until done is called
+ * @param n     Integer number of bytes
+ * @param done  Completion callback, or 0
+ * @param arg   Argument passed to done
+ * @returns Integer DMA channel, or -1 if none are free
+ */
+int32_t uart_write_dma(const char *buf, uint32_t n, void (*done)(void *),
+                       void *arg);
+
+/**
+ * @brief Receives exactly n bytes by DMA, paced by the UART0 RX DREQ.
+ * Receive errors are not reported. Do not use in interrupt-driven mode,
+ * the RX interrupt would race the DMA for the FIFO.
+ * @param buf   Buffer for received bytes
+ * @param n     Integer number of bytes
+ * @param done  Completion callback, or 0
+ * @param arg   Argument passed to done
+ * @returns Integer DMA channel, or -1 if none are free
+ */
+int32_t uart_read_dma(char *buf, uint32_t n, void (*done)(void *),
+                      void *arg);
+
+/**
+ * @brief Returns the number of received bytes dropped because the RX ring
+ *        or FIFO was full, or received with an error.
+ * @returns Integer dropped byte count
+ */
+uint32_t uart_rx_dropped();
+
 /**
  * @brief Sets baudrate for UART0 instance.
  * @param baudrate  Integer baudrate
@@ -0,0 +1,57 @@
+/**
+ * @file uart_print.c
+ * @brief Implements the UART text helpers of uart.h over uart_write, so
+ *        they serve both the RP2350 and the qemu-virt driver.
+ * @author Herbie Rand
+ */
+
+#include "types.h"
+#include "uart.h"
+
+void uart_puts(const char *s) {
+    const char *e = s;
+
+    while (*e) {
+        e++;
+    }
+    uart_write(s, e - s);
+}
+
+void uart_putu(uint32_t v) {
+    char buf[10];
+    uint32_t i = sizeof(buf);
+
+    do {
+        buf[--i] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    uart_write(&buf[i], sizeof(buf) - i);
+}
+
+// 64-bit division would pull in libgcc, so peel off digits by subtraction
+void uart_putu64(uint64_t v) {
+    static const uint64_t pow10[] = {
+        10000000000000000000ULL, 1000000000000000000ULL, 100000000000000000ULL,
+        10000000000000000ULL, 1000000000000000ULL, 100000000000000ULL,
+        10000000000000ULL, 1000000000000ULL, 100000000000ULL,
+        10000000000ULL, 1000000000ULL, 100000000ULL, 10000000ULL,
+        1000000ULL, 100000ULL, 10000ULL, 1000ULL, 100ULL, 10ULL, 1ULL,
+    };
+    char buf[sizeof(pow10) / sizeof(pow10[0])];
+    uint32_t n = 0;
+    char d;
+
+    if (!(v >> 32)) {
+        uart_putu((uint32_t)v);
+        return;
+    }
+    for (uint32_t i = 0; i < sizeof(pow10) / sizeof(pow10[0]); i++) {
+        for (d = '0'; v >= pow10[i]; d++) {
+            v -= pow10[i];
+        }
+        if (d != '0' || n) {
+            buf[n++] = d;
+        }
+    }
+    uart_write(buf, n);
+}
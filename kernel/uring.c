@@ -0,0 +1,210 @@
+/**
+ * @file uring.c
+ * @brief Kernel side of the batched syscall rings, see include/uring.h.
+ *
+ * Rings are drained by sys_uring_enter, and by a periodic timer on the
+ * core that set one up for polling. Each SQE is run through syscall_table
+ * like an ecall would, for the syscalls in URING_OPS: those that neither
+ * switch tasks nor leave U-mode. The polling timer runs in interrupt
+ * context, so it also refuses those in URING_BLOCKING_OPS. Anything else
+ * completes with -1.
+ *
+ * The rings themselves are URING_MAX slots at the front of .uheap, which
+ * U-mode may access but malloc never hands out, and the kernel keeps its
+ * own record of which are in use. A ring torn down, or left behind by a
+ * task that exited, is no longer drained or polled, and whatever U-mode
+ * still writes to it stays within the slot.
+ *
+ * Draining holds one lock for all rings, since a task may move to the
+ * other core while its ring is polled here. The polling timer skips a
+ * period rather than spin on it.
+ *
+ * @author Herbie Rand
+ */
+
+#include "asm.h"
+#include "mtime.h"
+#include "rp2350.h"
+#include "runtime.h"
+#include "sched.h"
+#include "spinlock.h"
+#include "sys.h"
+#include "syscall.h"
+#include "timer.h"
+#include "types.h"
+#include "uring.h"
+
+#define MASK (URING_ENTRIES - 1)
+
+#define URING_OPS                                                              \
+    ((1 << SYS_LED_ON) | (1 << SYS_LED_OFF) | (1 << SYS_SPIN_MS) |             \
+     (1 << SYS_NULL))
+/** @brief Ops that hold up the core, refused when polling */
+#define URING_BLOCKING_OPS (1 << SYS_SPIN_MS)
+
+static spinlock_t lock;
+
+// in .uheap, zeroed at boot, see util/memmap_template
+__attribute__((section(".uheap"))) static uring_t rings[URING_MAX];
+
+/** @brief Kernel's record of a ring slot, out of U-mode's reach */
+typedef struct {
+    uint32_t used;
+    /** @brief Task that set the ring up, 0 outside the scheduler */
+    const task_t *owner;
+} slot_t;
+
+static slot_t slots[URING_MAX];
+
+/** @brief Ring polled by a core, if any */
+typedef struct {
+    uring_t *ring;
+    uint64_t period;
+    ktimer_t timer;
+} poll_t;
+
+static poll_t poll[NUM_CORES];
+
+static void _teardown(uint32_t i);
+static uint32_t _drain(uring_t *r, uint32_t ops);
+static void _poll(void *arg);
+
+// Slot index of a ring in use, or URING_MAX if r is not one
+static __inline uint32_t _slot(const uring_t *r) {
+    uint32_t off = (uint32_t)r - (uint32_t)rings;
+    uint32_t i = off / sizeof(uring_t);
+
+    if (i >= URING_MAX || off != i * sizeof(uring_t) || !slots[i].used) {
+        return URING_MAX;
+    }
+    return i;
+}
+
+uring_t *sys_uring_setup(uint32_t poll_us) {
+    uint32_t id = this_cpu()->id;
+    uring_t *r = 0;
+
+    spinlock_lock(&lock);
+    for (uint32_t i = 0; i < URING_MAX; i++) {
+        if (!slots[i].used) {
+            slots[i].used = 1;
+            slots[i].owner = sched_current();
+            r = &rings[i];
+            r->sq_head = r->sq_tail = 0;
+            r->cq_head = r->cq_tail = 0;
+            break;
+        }
+    }
+    if (!r) {
+        spinlock_unlock(&lock);
+        return 0;
+    }
+    // may still be armed if the ring was torn down from the other core
+    timer_cancel(&poll[id].timer);
+    poll[id].ring = 0;
+    if (poll_us) {
+        poll[id].ring = r;
+        poll[id].period = us_to_ticks(poll_us);
+        timer_start(&poll[id].timer, mtime_read() + poll[id].period, _poll,
+                    &poll[id]);
+        set_mie(MTI_MASK);
+    }
+    spinlock_unlock(&lock);
+    return r;
+}
+
+int32_t sys_uring_teardown(uring_t *r) {
+    uint32_t i;
+
+    spinlock_lock(&lock);
+    i = _slot(r);
+    if (i < URING_MAX) {
+        _teardown(i);
+    }
+    spinlock_unlock(&lock);
+    return i < URING_MAX ? 0 : -1;
+}
+
+void uring_task_exit(const task_t *t) {
+    spinlock_lock(&lock);
+    for (uint32_t i = 0; i < URING_MAX; i++) {
+        if (slots[i].used && slots[i].owner == t) {
+            _teardown(i);
+        }
+    }
+    spinlock_unlock(&lock);
+}
+
+uint32_t sys_uring_enter(uring_t *r) {
+    uint32_t n = 0;
+
+    spinlock_lock(&lock);
+    if (_slot(r) < URING_MAX) {
+        n = _drain(r, URING_OPS);
+    }
+    spinlock_unlock(&lock);
+    return n;
+}
+
+// Frees a slot and stops polling it, with the lock held. A polling timer
+// on the other core cannot be cancelled from here, it stops on its next
+// expiry instead.
+static void _teardown(uint32_t i) {
+    uint32_t id = this_cpu()->id;
+
+    for (uint32_t c = 0; c < NUM_CORES; c++) {
+        if (poll[c].ring == &rings[i]) {
+            poll[c].ring = 0;
+            if (c == id) {
+                timer_cancel(&poll[c].timer);
+            }
+        }
+    }
+    slots[i].used = 0;
+    slots[i].owner = 0;
+}
+
+// Runs queued SQEs while the CQ has room, returns how many
+static uint32_t _drain(uring_t *r, uint32_t ops) {
+    uint32_t head = r->sq_head;
+    uint32_t tail = __atomic_load_n(&r->sq_tail, __ATOMIC_ACQUIRE);
+    uint32_t cq = r->cq_tail;
+    uint32_t n = 0;
+    uring_sqe_t e;
+    uring_cqe_t *c;
+
+    while (head != tail &&
+           cq - __atomic_load_n(&r->cq_head, __ATOMIC_ACQUIRE) <
+               URING_ENTRIES) {
+        // U-mode may rewrite the SQE meanwhile, so act on a copy
+        e = r->sq[head++ & MASK];
+        c = &r->cq[cq++ & MASK];
+        c->user_data = e.user_data;
+        if (e.op < SYSCALL_COUNT && ((ops >> e.op) & 1)) {
+            c->res = ((int32_t (*)(uint32_t, uint32_t))syscall_table[e.op])(
+                e.a0, e.a1);
+        } else {
+            c->res = -1;
+        }
+        n++;
+    }
+    __atomic_store_n(&r->sq_head, head, __ATOMIC_RELEASE);
+    __atomic_store_n(&r->cq_tail, cq, __ATOMIC_RELEASE);
+    return n;
+}
+
+// Periodic, re-armed from its own deadline like the scheduler tick, until
+// the ring is torn down
+static void _poll(void *arg) {
+    poll_t *p = arg;
+
+    if (spinlock_trylock(&lock)) {
+        if (!p->ring) {
+            spinlock_unlock(&lock);
+            return;
+        }
+        _drain(p->ring, URING_OPS & ~URING_BLOCKING_OPS);
+        spinlock_unlock(&lock);
+    }
+    timer_start(&p->timer, p->timer.deadline + p->period, _poll, p);
+}
@@ -0,0 +1,98 @@
+/**
+ * @file work.c
+ * @brief Implements deferred interrupt work, see work.h.
+ * @author Herbie Rand
+ */
+
+#include "work.h"
+#include "asm.h"
+#include "irq_stats.h"
+#include "riscv.h"
+#include "rp2350.h"
+#include "runtime.h"
+#include "section.h"
+#include "types.h"
+
+/** @brief Per-core FIFO of queued work, only touched with MIE clear */
+typedef struct {
+    work_t *head;
+    work_t *tail;
+    /** @brief Nonzero while work_msi runs the queue, with MSIE clear */
+    uint8_t running;
+    /** @brief Nonzero if work_queue raised the software interrupt */
+    uint8_t raised;
+} work_cpu_t;
+
+static work_cpu_t queues[NUM_CORES];
+
+void isr_soft_irq();
+
+uint32_t work_queue(work_t *w) {
+    uint32_t mie = irq_save();
+    uint32_t id = this_cpu()->id;
+    work_cpu_t *q = &queues[id];
+
+    if (w->queued) {
+        irq_restore(mie);
+        return 0;
+    }
+    w->queued = 1;
+    w->next = 0;
+    if (q->tail) {
+        q->tail->next = w;
+    } else {
+        q->head = w;
+    }
+    q->tail = w;
+    // a run in progress takes it too; enabling MSIE under it, with MIE on,
+    // would have isr_msi nest for every item that queues itself again
+    if (!q->running) {
+        q->raised = 1;
+        set_mie(MSI_MASK);
+        softirq_raise(id);
+    }
+    irq_restore(mie);
+    return 1;
+}
+
+__time_critical void work_msi() {
+    uint32_t id = this_cpu()->id;
+    work_cpu_t *q = &queues[id];
+    uint32_t external;
+    uint32_t own;
+    work_t *w;
+#ifdef IRQ_STATS
+    uint32_t start = csr_read(mcycle);
+#endif
+
+    // a raise from here on traps again; one before it is for this call,
+    // from softirq_set, from work_queue, or written to SIO by hand
+    softirq_clear(id);
+    external = softirq_take();
+    own = q->raised;
+    q->raised = 0;
+
+    if (q->head) {
+        // work queued meanwhile joins this run, so keep isr_msi from nesting
+        csr_clear(mie, MSI_MASK);
+        q->running = 1;
+        while ((w = q->head)) {
+            q->head = w->next;
+            if (!q->head) {
+                q->tail = 0;
+            }
+            w->queued = 0;
+            irq_restore(MIE_MASK);
+            w->fn(w->arg);
+            irq_save();
+        }
+        q->running = 0;
+        csr_set(mie, MSI_MASK);
+    }
+    if (external || !own) {
+        isr_soft_irq();
+    }
+#ifdef IRQ_STATS
+    irq_stats_record(IRQ_STATS_MSI, start, 0);
+#endif
+}
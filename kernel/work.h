@@ -0,0 +1,53 @@
+/**
+ * @file work.h
+ * @brief Deferred interrupt work, to keep handlers short.
+ *
+ * A handler does only what cannot wait, e.g. acknowledging the device, and
+ * queues the rest as a work_t on its core. Queueing raises this core's
+ * software interrupt, and isr_msi then runs the queue in order, with
+ * interrupts enabled: external and timer interrupts preempt queued work,
+ * and masking time is bounded by the handlers alone. A work item runs on
+ * the core that queued it, like a ktimer fires on the core that armed it.
+ *
+ * Queueing raises the interrupt without softirq_set, so work_msi can tell
+ * its own raises apart: one from softirq_set, e.g. by the other core, still
+ * reaches isr_soft_irq, after the queue if both arrive at once.
+ *
+ * @author Herbie Rand
+ */
+
+#ifndef WORK_H
+#define WORK_H
+
+#include "types.h"
+
+/** @brief Deferred work item, owned by the caller */
+typedef struct work {
+    /** @brief Called from isr_msi, with interrupts enabled */
+    void (*fn)(void *);
+    /** @brief Argument passed to fn */
+    void *arg;
+    struct work *next;
+    /** @brief Nonzero from work_queue until fn is called */
+    volatile uint8_t queued;
+} work_t;
+
+/** @brief Initializer for a work_t that calls fn(arg) */
+#define WORK_INIT(f, a) {.fn = (f), .arg = (a), .next = 0, .queued = 0}
+
+/**
+ * @brief Queues work to run on this core once interrupt handlers are done.
+ * Safe from any handler, and from the work itself to run it again. Work
+ * already queued is not queued twice, so bursts coalesce into one call.
+ * @param w Work to queue, must stay valid until it has run
+ * @returns 1 if queued, 0 if it already was
+ */
+uint32_t work_queue(work_t *w);
+
+/**
+ * @brief Runs this core's queued work, called by isr_msi. Then calls
+ *        isr_soft_irq, unless the interrupt was only raised by work_queue.
+ */
+void work_msi();
+
+#endif
@@ -0,0 +1,253 @@
+/**
+ * @brief Runs the kernel benchmark suite and reports over the UART.
+ *
+ * Cases:
+ * - empty: back to back bench_begin/bench_end, the timing overhead
+ * - isr_mti, isr_msi, isr_mei: from unmasking a pending interrupt to the
+ *   first line of its C handler
+ * - isr_mti_cold, isr_msi_cold, isr_mei_cold: the same, with the XIP cache
+ *   invalidated first, so the max is the worst-case latency
+ * - isr_mei_chain: CHAIN back-to-back external interrupts, each pending
+ *   again as its handler returns, from the first force to the last handler
+ * - work: from work_queue to the first line of the deferred work, run from
+ *   isr_msi, see work.h
+ * - syscall: null syscall round trip from a U-mode caller, fast path
+ * - now_us: reading the time from U-mode, which takes no trap
+ * - mtimer_hit, mtimer_miss: mtimer_start with the mtime_cache_t hit
+ *   (same period every time) and missed (alternating periods)
+ *
+ * The report starts with the boot-phase timestamps, see boot.h.
+ *
+ * Capture the report with `make console REPORT=bench.csv`. The final
+ * breakpoint is reached once the report has been sent. Build again with
+ * TIME_CRITICAL_XIP=1 to compare the trap path run from flash against SRAM,
+ * see section.h, or with MEI_NO_CHAIN=1 to compare isr_mei_chain without
+ * tail-chaining, see isr_mei in startup.S. Built with IRQ_STATS=1, the
+ * report ends with the time spent in each handler, see irq_stats.h; the
+ * isr_mti cases arm a deadline of 0, so their latency is the whole uptime.
+ *
+ * Under QEMU (`make qemu BOARD=qemu-virt TEST=test_bench REPORT=bench.csv`)
+ * cycles count instructions. There is no XIP cache, so cold cases equal
+ * warm ones, and no way to force an external interrupt, so isr_mei* are
+ * left out.
+ *
+ * @author Herbie Rand
+ */
+#include "asm.h"
+#include "bench.h"
+#include "boot.h"
+#include "irq_stats.h"
+#include "mtime.h"
+#include "riscv.h"
+#include "rp2350.h"
+#include "runtime.h"
+#include "types.h"
+#include "uart.h"
+#include "time.h"
+#include "usys.h"
+#include "work.h"
+
+#define RUNS 200
+// SPARE_IRQ_0, only ever raised by forcing it through MEIFA
+#define BENCH_IRQ 46
+#define CHAIN     8
+
+extern uint32_t __ustack0_base;
+
+void isr_mtimer_irq();
+void isr_soft_irq();
+void isr_irq46();
+void user_syscall(uint32_t arg);
+void user_now(uint32_t arg);
+
+// sample being timed by an interrupt handler
+static bench_sample_t *volatile pending;
+static void deferred(void *arg);
+static work_t bench_work = WORK_INIT(deferred, 0);
+
+// interrupts left in an isr_mei_chain sample
+static uint32_t chain = 0;
+
+// Drops every line of the XIP cache, so the next flash fetches all miss
+static void xip_invalidate() {
+#ifndef BOARD_QEMU_VIRT
+    for (uint32_t off = 0; off < XIP_CACHE_SIZE; off += XIP_CACHE_LINE) {
+        *(volatile uint8_t *)(XIP_MAINTENANCE_BASE + off +
+                              XIP_INVALIDATE_BY_SET_WAY) = 0;
+    }
+#endif
+}
+
+static void empty(bench_sample_t *s, void *arg) {
+    (void)arg;
+    bench_begin(s);
+    bench_end(s);
+}
+
+static void mti(bench_sample_t *s, void *arg) {
+    // the timer service is not running, so isr_mti calls isr_mtimer_irq
+    pending = s;
+    mtimer_set(0);
+    if (arg) {
+        xip_invalidate();
+    }
+    bench_begin(s);
+    set_mie(MTI_MASK);
+    while (pending)
+        ;
+}
+
+static void msi(bench_sample_t *s, void *arg) {
+    pending = s;
+    if (arg) {
+        xip_invalidate();
+    }
+    bench_begin(s);
+    softirq_set(0);
+    while (pending)
+        ;
+}
+
+static void mei(bench_sample_t *s, void *arg) {
+    pending = s;
+    if (arg) {
+        xip_invalidate();
+    }
+    bench_begin(s);
+    irq_force(BENCH_IRQ);
+    while (pending)
+        ;
+}
+
+static void mei_chain(bench_sample_t *s, void *arg) {
+    (void)arg;
+    chain = CHAIN;
+    mei(s, 0);
+}
+
+static void work(bench_sample_t *s, void *arg) {
+    (void)arg;
+    pending = s;
+    bench_begin(s);
+    work_queue(&bench_work);
+    while (pending)
+        ;
+}
+
+static void deferred(void *arg) {
+    (void)arg;
+    bench_end(pending);
+    pending = 0;
+}
+
+// Runs the U-mode function arg, which times itself, see user_syscall
+static void user_case(bench_sample_t *s, void *arg) {
+    uint64_t r;
+
+    r = user_call((void (*)(uint32_t))arg, 0, (uint32_t)&__ustack0_base);
+    s->cycles = (uint32_t)r;
+    s->instret = (uint32_t)(r >> 32);
+}
+
+static void mtimer(bench_sample_t *s, void *arg) {
+    static uint32_t toggle = 0;
+    uint32_t us = 1000000;
+
+    // a miss alternates between two periods, so the cache never matches
+    if (arg) {
+        toggle ^= 1;
+        us += toggle;
+    }
+    bench_begin(s);
+    mtimer_start(us);
+    bench_end(s);
+}
+
+int main() {
+    boot_init();
+    uart_init();
+    boot_report();
+    bench_init();
+
+    bench_run("empty", empty, 0, RUNS, 0);
+
+    bench_run("isr_mti", mti, 0, RUNS, 0);
+    bench_run("isr_mti_cold", mti, (void *)1, RUNS, 0);
+
+    set_mie(MSI_MASK);
+    bench_run("isr_msi", msi, 0, RUNS, 0);
+    bench_run("isr_msi_cold", msi, (void *)1, RUNS, 0);
+
+#ifndef BOARD_QEMU_VIRT
+    irq_enable(BENCH_IRQ);
+    bench_run("isr_mei", mei, 0, RUNS, 0);
+    bench_run("isr_mei_cold", mei, (void *)1, RUNS, 0);
+    bench_run("isr_mei_chain", mei_chain, 0, RUNS, 0);
+    irq_disable(BENCH_IRQ);
+#endif
+
+    bench_run("work", work, 0, RUNS, 0);
+    bench_run("syscall", user_case, user_syscall, RUNS, 0);
+    bench_run("now_us", user_case, user_now, RUNS, 0);
+
+    mtimer_enable();
+    bench_run("mtimer_hit", mtimer, 0, RUNS, 0);
+    bench_run("mtimer_miss", mtimer, (void *)1, RUNS, 0);
+
+    irq_stats_report();
+    bench_done();
+    breakpoint();
+
+    return 0;
+}
+
+void isr_mtimer_irq() {
+    // mtimer cases leave a timer armed, which may fire later on
+    if (!pending) {
+        return;
+    }
+    bench_end(pending);
+    csr_clear(mie, MTI_MASK);
+    mtimer_set(MAX_UINT64);
+    pending = 0;
+}
+
+void isr_soft_irq() {
+    bench_end(pending);
+    softirq_clear(0);
+    pending = 0;
+}
+
+void isr_irq46() {
+    // left forced, the IRQ is pending again as soon as this returns
+    if (chain && --chain) {
+        return;
+    }
+    bench_end(pending);
+    clr_meifa();
+    pending = 0;
+}
+
+// Runs in U-mode, timed with the user-readable counters
+void user_syscall(uint32_t arg) {
+    uint32_t c = csr_read(cycle);
+    uint32_t i = csr_read(instret);
+
+    (void)arg;
+    null_syscall();
+    c = csr_read(cycle) - c;
+    i = csr_read(instret) - i;
+    user_return(c, i);
+}
+
+// Runs in U-mode, like user_syscall
+void user_now(uint32_t arg) {
+    uint32_t c = csr_read(cycle);
+    uint32_t i = csr_read(instret);
+
+    (void)arg;
+    now_us();
+    c = csr_read(cycle) - c;
+    i = csr_read(instret) - i;
+    user_return(c, i);
+}
@@ -4,7 +4,8 @@
  *
  * Expected behavior is blinking LED, identical to test_blinky_interrupt.
  * However, core 0 should spin indefinitely, and core 1 should be executing
- * the mtimer interrupt handler.
+ * the mtimer interrupt handler, which re-arms the timer and defers the GPIO
+ * work to core 1's queue, see work.h.
  *
  * @author Herbie Rand
  */
@@ -14,23 +15,20 @@
 #include "rp2350.h"
 #include "runtime.h"
 #include "types.h"
+#include "work.h"
 
 #define LED_PIN 25
 
 void blinky();
 void isr_mtimer_irq();
-
-extern uint32_t __vector_table;
-extern uint32_t __mstack1_base;
-
-uint32_t *vt = &__vector_table;
-uint32_t *sp1 = &__mstack1_base;
+void toggle(void *arg);
 
 static uint8_t on = 0;
-static uint32_t us = 5000000;
+static uint32_t us = 500000;
+static work_t blink = WORK_INIT(toggle, 0);
 
 int main() {
-    init_core1((uint32_t)vt, (uint32_t)sp1, (uint32_t)blinky);
+    launch_core1(blinky);
     while (1) {
         asm volatile("wfi");
     }
@@ -53,11 +51,16 @@ void blinky() {
 }
 
 void isr_mtimer_irq() {
+    mtimer_start(us);
+    work_queue(&blink);
+}
+
+void toggle(void *arg) {
+    (void)arg;
     if (!on) {
         gpio_set(LED_PIN);
     } else {
         gpio_clr(LED_PIN);
     }
     on = ~on;
-    mtimer_start(us);
 }
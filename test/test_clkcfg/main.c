@@ -1,10 +1,8 @@
 /**
  * @brief Tests blinky with mtimer interrupt.
  *
- * The actual rate of blinking depends on the clock source and environment.
- * However, assuming that the clock uses the default ROSC at nominal clock
- * rate of 11 MHz, `mtimer_start` will behave correctly, and the led will
- * blink on for 0.5 seconds, off for 0.5 seconds, repeatedly.
+ * mtime ticks at MTIME_TICKS_PER_US once the clocks are configured, so the
+ * led will blink on for 0.5 seconds, off for 0.5 seconds, repeatedly.
  *
  * @author Herbie Rand
  */
@@ -17,7 +15,7 @@
 #define LED_PIN 25
 
 static uint8_t on = 0;
-static uint32_t us = 5000000;
+static uint32_t us = 500000;
 
 int main() {
     clock_defaults_set();
@@ -0,0 +1,167 @@
+/**
+ * @brief Benchmarks the TLSF heap's worst-case latency and fragmentation,
+ *        and reports over the UART.
+ *
+ * A heap of HEAP_SIZE bytes is churned first: NLIVE slots each hold a block
+ * of random size between MIN_LEN and MAX_LEN, and each step frees a random
+ * slot and refills it, until the heap reaches a steady fragmented state.
+ *
+ * Cases, all on the churned heap, where the max is the worst case seen:
+ * - tlsf_alloc, tlsf_free: one step of the churn, timing either half
+ * - tlsf_alloc_large: a block larger than any free one, which must fail
+ *   after the same two bit scans as any other request
+ * - malloc, free: the user heap, timed from U-mode, where it runs without
+ *   a trap, see user/heap.h
+ *
+ * Capture the report with `make console REPORT=heap.csv`. At the final
+ * breakpoint, churned holds the statistics of the churned heap: the
+ * fragmentation is 1 - largest_free / free, and every block is checked to
+ * have kept its contents, or the test fails at once.
+ *
+ * @author Herbie Rand
+ */
+#include "asm.h"
+#include "bench.h"
+#include "boot.h"
+#include "heap.h"
+#include "riscv.h"
+#include "tlsf.h"
+#include "types.h"
+#include "uart.h"
+#include "usys.h"
+
+#define HEAP_SIZE 32768
+#define NLIVE     128
+#define MIN_LEN   16
+#define MAX_LEN   384
+#define WARMUP    20000
+#define RUNS      200
+
+extern uint32_t __ustack0_base;
+
+void user_malloc(uint32_t size);
+
+static uint64_t heap_mem[HEAP_SIZE / 8];
+static tlsf_t heap;
+
+static uint32_t *live[NLIVE];
+static uint32_t len[NLIVE];
+
+static tlsf_stats_t churned;
+
+static uint32_t _rand() {
+    static uint32_t x = 1;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+// Frees slot k, after checking its block kept the words written below
+static void _release(uint32_t k, bench_sample_t *s) {
+    for (uint32_t i = 0; live[k] && i < len[k] / 4; i++) {
+        if (live[k][i] != (k << 16 | i)) {
+            test_fail();
+        }
+    }
+    if (s) {
+        bench_begin(s);
+    }
+    tlsf_free(&heap, live[k]);
+    if (s) {
+        bench_end(s);
+    }
+    live[k] = 0;
+}
+
+static void _fill(uint32_t k, bench_sample_t *s) {
+    len[k] = MIN_LEN + _rand() % (MAX_LEN - MIN_LEN + 1);
+    if (s) {
+        bench_begin(s);
+    }
+    live[k] = tlsf_alloc(&heap, len[k]);
+    if (s) {
+        bench_end(s);
+    }
+    for (uint32_t i = 0; live[k] && i < len[k] / 4; i++) {
+        live[k][i] = k << 16 | i;
+    }
+}
+
+static void churn(bench_sample_t *s, void *arg) {
+    uint32_t k = _rand() % NLIVE;
+
+    _release(k, arg ? s : 0);
+    _fill(k, arg ? 0 : s);
+}
+
+static void alloc_large(bench_sample_t *s, void *arg) {
+    (void)arg;
+    bench_begin(s);
+    if (tlsf_alloc(&heap, HEAP_SIZE)) {
+        test_fail();
+    }
+    bench_end(s);
+}
+
+static void umode_malloc(bench_sample_t *s, void *arg) {
+    uint64_t r;
+
+    r = user_call(user_malloc, (uint32_t)arg, (uint32_t)&__ustack0_base);
+    if (r >> 32 == MAX_UINT32) {
+        test_fail(); // malloc failed
+    }
+    s->cycles = (uint32_t)r;
+    s->instret = 0;
+}
+
+static void umode_free(bench_sample_t *s, void *arg) {
+    uint64_t r;
+
+    r = user_call(user_malloc, (uint32_t)arg, (uint32_t)&__ustack0_base);
+    s->cycles = (uint32_t)(r >> 32);
+    s->instret = 0;
+}
+
+int main() {
+    boot_init();
+    uart_init();
+    bench_init();
+
+    tlsf_init(&heap, heap_mem, sizeof(heap_mem));
+    for (uint32_t i = 0; i < WARMUP; i++) {
+        churn(0, 0);
+    }
+
+    bench_run("tlsf_alloc", churn, 0, RUNS, 0);
+    bench_run("tlsf_free", churn, (void *)1, RUNS, 0);
+    bench_run("tlsf_alloc_large", alloc_large, 0, RUNS, 0);
+    tlsf_stats(&heap, &churned);
+
+    bench_run("malloc", umode_malloc, (void *)64, RUNS, 0);
+    bench_run("free", umode_free, (void *)64, RUNS, 0);
+
+    bench_done();
+    breakpoint();
+
+    return 0;
+}
+
+// Runs in U-mode, returns the cycles of malloc and of free, or MAX_UINT32
+// in place of the latter if malloc failed
+void user_malloc(uint32_t size) {
+    uint32_t c = csr_read(cycle);
+    uint32_t f;
+    void *p;
+
+    p = malloc(size);
+    c = csr_read(cycle) - c;
+    if (!p) {
+        user_return(c, MAX_UINT32);
+    }
+    f = csr_read(cycle);
+    free(p);
+    f = csr_read(cycle) - f;
+    user_return(c, f);
+}
@@ -0,0 +1,133 @@
+/**
+ * @brief Benchmarks inter-core channels against the bare SIO FIFO.
+ *
+ * Core 1 first serves the bare FIFO: it echoes NPING words, then sinks
+ * NWORDS words and replies with their sum. It then switches to ipc and does
+ * the same through the shared rings, with core 0 sending in CHUNK word
+ * bursts. Both cores sleep in wfi whenever they wait on ipc.
+ *
+ * At the final breakpoint, fifo.* and ipc.* hold the average round trip in
+ * cycles (ping) and cycles per word moved (bulk). Expect ipc.bulk to be far
+ * below fifo.bulk, and ipc.ping to be a few times fifo.ping, the cost of the
+ * doorbell interrupt.
+ *
+ * @author Herbie Rand
+ */
+#include "asm.h"
+#include "clock.h"
+#include "fifo.h"
+#include "ipc.h"
+#include "riscv.h"
+#include "rp2350.h"
+#include "runtime.h"
+#include "types.h"
+
+#define NPING  1000
+#define NWORDS 65536
+#define CHUNK  64
+
+typedef struct {
+    uint32_t ping;
+    uint32_t bulk;
+} result_t;
+
+void core1();
+
+static uint32_t buf[CHUNK];
+static uint32_t buf1[CHUNK];
+static result_t fifo;
+static result_t ipc;
+
+int main() {
+    uint32_t start;
+    uint32_t sum = 0;
+    uint32_t v;
+
+    clock_defaults_set();
+    ipc_init();
+    launch_core1(core1);
+
+    // bare FIFO, one word per handshake
+    start = csr_read(mcycle);
+    for (uint32_t i = 0; i < NPING; i++) {
+        multicore_fifo_push_blocking(i);
+        if (multicore_fifo_pop_blocking() != i) {
+            test_fail();
+        }
+    }
+    fifo.ping = (csr_read(mcycle) - start) / NPING;
+
+    start = csr_read(mcycle);
+    for (uint32_t i = 0; i < NWORDS; i++) {
+        multicore_fifo_push_blocking(i);
+        sum += i;
+    }
+    if (multicore_fifo_pop_blocking() != sum) {
+        test_fail();
+    }
+    fifo.bulk = (csr_read(mcycle) - start) / NWORDS;
+
+    // ipc, core 1 enables its side as soon as it has replied
+    ipc_enable();
+
+    start = csr_read(mcycle);
+    for (uint32_t i = 0; i < NPING; i++) {
+        ipc_send(&i, 1);
+        ipc_recv(&v, 1);
+        if (v != i) {
+            test_fail();
+        }
+    }
+    ipc.ping = (csr_read(mcycle) - start) / NPING;
+
+    for (uint32_t i = 0; i < CHUNK; i++) {
+        buf[i] = i;
+    }
+    start = csr_read(mcycle);
+    for (uint32_t i = 0; i < NWORDS / CHUNK; i++) {
+        ipc_send(buf, CHUNK);
+    }
+    ipc_recv(&v, 1);
+    if (v != (NWORDS / CHUNK) * (CHUNK * (CHUNK - 1) / 2)) {
+        test_fail();
+    }
+    ipc.bulk = (csr_read(mcycle) - start) / NWORDS;
+
+    breakpoint();
+
+    return 0;
+}
+
+void core1() {
+    uint32_t sum = 0;
+    uint32_t v;
+    uint32_t n;
+
+    for (uint32_t i = 0; i < NPING; i++) {
+        multicore_fifo_push_blocking(multicore_fifo_pop_blocking());
+    }
+    for (uint32_t i = 0; i < NWORDS; i++) {
+        sum += multicore_fifo_pop_blocking();
+    }
+    multicore_fifo_push_blocking(sum);
+
+    set_mstatus(MIE_MASK);
+    ipc_enable();
+
+    for (uint32_t i = 0; i < NPING; i++) {
+        ipc_recv(&v, 1);
+        ipc_send(&v, 1);
+    }
+    sum = 0;
+    for (uint32_t i = 0; i < NWORDS; i += n) {
+        n = ipc_recv(buf1, CHUNK);
+        for (uint32_t j = 0; j < n; j++) {
+            sum += buf1[j];
+        }
+    }
+    ipc_send(&sum, 1);
+
+    while (1) {
+        asm volatile("wfi");
+    }
+}
@@ -0,0 +1,105 @@
+/**
+ * @brief Tests handlers installed at runtime, with their context pointers
+ *        and priorities.
+ *
+ * One handler serves three spare IRQs, told apart by their context: each
+ * clears its own force bit, forces the next IRQ, if any, then records its
+ * own id. With increasing
+ * priorities every force preempts, so the last IRQ finishes first; with
+ * decreasing ones each waits for the handler before it and is tail-chained.
+ * Last, under irq_ceiling_save(2), the IRQ of priority 1 is forced first
+ * but must wait, while the one of priority 3 is taken at once. The one it
+ * forces has priority 2, at the ceiling, and must wait too: any of them
+ * taken before irq_ceiling_restore fails the test.
+ *
+ * At the final breakpoint, order == {3, 2, 1, 1, 2, 3, 1, 2, 3} and
+ * count == 9, or the test fails. Forcing IRQs takes Hazard3's MEIFA, so
+ * this does not run under BOARD_QEMU_VIRT.
+ *
+ * @author Herbie Rand
+ */
+#include "asm.h"
+#include "irq.h"
+#include "rp2350.h"
+#include "types.h"
+
+// SPARE_IRQ_0 to SPARE_IRQ_2, only ever raised by forcing them
+#define FIRST_IRQ 46
+#define NIRQS     3
+
+typedef struct {
+    uint32_t id;
+    uint32_t irq;
+    uint32_t next;
+} spare_t;
+
+static spare_t spare[NIRQS] = {
+    {1, FIRST_IRQ, FIRST_IRQ + 1},
+    {2, FIRST_IRQ + 1, FIRST_IRQ + 2},
+    {3, FIRST_IRQ + 2, 0},
+};
+
+static const uint32_t expected[3 * NIRQS] = {3, 2, 1, 1, 2, 3, 1, 2, 3};
+static uint32_t order[3 * NIRQS];
+static volatile uint32_t count = 0;
+
+static void on_spare(void *ctx) {
+    spare_t *s = ctx;
+
+    // clearing every force bit would drop those still pending
+    irq_unforce(s->irq);
+    if (s->next) {
+        irq_force(s->next);
+    }
+    order[count++] = s->id;
+}
+
+static void run(uint32_t first_prio, int32_t step) {
+    uint32_t done = count + NIRQS;
+
+    for (uint32_t i = 0; i < NIRQS; i++) {
+        irq_set_priority(FIRST_IRQ + i, first_prio + step * (int32_t)i);
+    }
+    irq_force(FIRST_IRQ);
+    while (count != done)
+        ;
+}
+
+int main() {
+    uint32_t ceiling;
+
+    for (uint32_t i = 0; i < NIRQS; i++) {
+        irq_set_handler(FIRST_IRQ + i, on_spare, &spare[i]);
+        irq_enable(FIRST_IRQ + i);
+    }
+
+    run(1, 1);
+    run(3, -1);
+
+    ceiling = irq_ceiling_save(2);
+    irq_force(FIRST_IRQ + 2);
+    irq_force(FIRST_IRQ);
+    while (count == 2 * NIRQS)
+        ;
+    // only priority 3 ran, the IRQ it forced at the ceiling is still held
+    if (count != 2 * NIRQS + 1 || order[2 * NIRQS] != 3) {
+        test_fail();
+    }
+    irq_ceiling_restore(ceiling);
+    while (count != 3 * NIRQS)
+        ;
+
+    for (uint32_t i = 0; i < NIRQS; i++) {
+        irq_disable(FIRST_IRQ + i);
+        irq_set_priority(FIRST_IRQ + i, 0);
+        irq_remove_handler(FIRST_IRQ + i);
+    }
+    for (uint32_t i = 0; i < 3 * NIRQS; i++) {
+        if (order[i] != expected[i]) {
+            test_fail();
+        }
+    }
+    breakpoint();
+
+    return 0;
+}
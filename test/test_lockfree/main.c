@@ -0,0 +1,148 @@
+/**
+ * @brief Stress tests the lock-free primitives across both cores and an ISR.
+ *
+ * Core 1 produces into an spsc_t and an mpsc_t, publishes snapshots through
+ * a seqlock_t and increments a shared atomic counter. On core 0, the mtimer
+ * ISR is a second mpsc_t producer, while main consumes both rings, reads
+ * snapshots and increments the same counter. Nothing disables interrupts.
+ *
+ * Each producer's values must arrive in order, and every snapshot must be
+ * consistent; any violation fails the test immediately.
+ *
+ * At the final breakpoint, expect spsc_seen == NITEMS, mpsc_seen[0] ==
+ * NITEMS, mpsc_seen[1] == NTICKS and counter == 2 * NITEMS. retries counts
+ * snapshot reads that overlapped a write.
+ *
+ * @author Herbie Rand
+ */
+#include "asm.h"
+#include "atomic.h"
+#include "clock.h"
+#include "mtime.h"
+#include "ring.h"
+#include "runtime.h"
+#include "seqlock.h"
+#include "types.h"
+
+#define NITEMS   100000
+#define NTICKS   2000
+#define RINGSIZE 64
+
+// top bit of an mpsc_t value says which producer it came from
+#define FROM_ISR 0x80000000
+
+void producer();
+void isr_mtimer_irq();
+
+static uint32_t spsc_buf[RINGSIZE];
+static mpsc_cell_t mpsc_cells[RINGSIZE];
+static spsc_t spsc;
+static mpsc_t mpsc;
+
+static seqlock_t lock;
+static struct {
+    uint32_t a;
+    uint32_t b;
+} snapshot = {0, 0xffffffff};
+
+static atomic_u32_t counter;
+static atomic_u32_t finished;
+
+static uint32_t ticks = 0;
+static uint32_t spsc_seen = 0;
+static uint32_t mpsc_seen[2];
+static uint32_t retries = 0;
+
+int main() {
+    uint32_t v;
+    uint32_t seq;
+    uint32_t a;
+    uint32_t b;
+    uint32_t i = 0;
+
+    clock_defaults_set();
+    spsc_init(&spsc, spsc_buf, RINGSIZE);
+    mpsc_init(&mpsc, mpsc_cells, RINGSIZE);
+    seqlock_init(&lock);
+
+    mtimer_enable();
+    mtimer_start(20);
+    launch_core1(producer);
+
+    while (spsc_seen < NITEMS || mpsc_seen[0] < NITEMS ||
+           mpsc_seen[1] < NTICKS) {
+        if (spsc_pop(&spsc, &v)) {
+            if (v != spsc_seen++) {
+                test_fail();
+            }
+        }
+        while (mpsc_pop(&mpsc, &v)) {
+            uint32_t from = (v & FROM_ISR) ? 1 : 0;
+            if ((v & ~FROM_ISR) != mpsc_seen[from]++) {
+                test_fail();
+            }
+        }
+
+        for (;;) {
+            seq = seqlock_read_begin(&lock);
+            a = snapshot.a;
+            b = snapshot.b;
+            if (!seqlock_read_retry(&lock, seq)) {
+                break;
+            }
+            retries++;
+        }
+        if (b != ~a) {
+            test_fail();
+        }
+
+        if (i < NITEMS) {
+            atomic_u32_add(&counter, 1);
+            i++;
+        }
+    }
+    while (i++ < NITEMS) {
+        atomic_u32_add(&counter, 1);
+    }
+    while (!atomic_u32_load(&finished))
+        ;
+
+    if (spsc_seen != NITEMS || mpsc_seen[0] != NITEMS ||
+        mpsc_seen[1] != NTICKS || atomic_u32_load(&counter) != 2 * NITEMS) {
+        test_fail();
+    }
+    breakpoint();
+
+    return 0;
+}
+
+void producer() {
+    for (uint32_t i = 0; i < NITEMS; i++) {
+        while (!spsc_push(&spsc, i))
+            ;
+        while (!mpsc_push(&mpsc, i))
+            ;
+
+        seqlock_write_begin(&lock);
+        snapshot.a = i;
+        snapshot.b = ~i;
+        seqlock_write_end(&lock);
+
+        atomic_u32_add(&counter, 1);
+    }
+    atomic_u32_store(&finished, 1);
+
+    while (1) {
+        asm volatile("wfi");
+    }
+}
+
+void isr_mtimer_irq() {
+    // a full ring is retried on the next tick, keeping the sequence intact
+    if (mpsc_push(&mpsc, FROM_ISR | ticks)) {
+        ticks++;
+    }
+    if (ticks < NTICKS) {
+        mtimer_start(20);
+    }
+}
@@ -0,0 +1,226 @@
+/**
+ * @brief Stress tests the block pool across both cores, then benchmarks it
+ *        against a naive allocator and reports over the UART.
+ *
+ * Stress: core 1 allocates messages, stamps them and passes them to core 0
+ * through an spsc_t, while core 0 frees them and allocates and frees its own
+ * in bursts. Every block is stamped on alloc and checked before free, so a
+ * block handed out twice fails the test. Blocks freed on core 0 spill to
+ * the shared list and are refilled by core 1, exercising the lock-free path.
+ *
+ * Cases, each against a pool and a naive first-fit allocator that scans a
+ * used[] table with interrupts off, both with BUSY of NBENCH blocks
+ * already in use:
+ * - pool_pair, naive_pair: one alloc and free
+ * - pool_burst, naive_burst: BURST allocs, then as many frees
+ *
+ * Capture the report with `make console REPORT=pool.csv`. At the final
+ * breakpoint, expect passed == NMSGS, msg_stats.in_use == 0 and
+ * msg_stats.failures == 0, with msg_stats.high_water at most NMSGBLOCKS.
+ *
+ * @author Herbie Rand
+ */
+#include "asm.h"
+#include "bench.h"
+#include "boot.h"
+#include "pool.h"
+#include "ring.h"
+#include "runtime.h"
+#include "types.h"
+#include "uart.h"
+
+#define NMSGS      50000
+#define NMSGBLOCKS 48
+#define RINGSIZE   16
+#define OWN_BURST  8
+
+#define NBENCH 256
+#define BUSY   192
+#define BURST  32
+#define RUNS   200
+
+typedef struct {
+    uint32_t owner;
+    uint32_t seq;
+    uint32_t payload[6];
+} msg_t;
+
+void producer();
+
+POOL_DEFINE(msg_pool, msg_t, NMSGBLOCKS);
+POOL_DEFINE(bench_pool, msg_t, NBENCH);
+
+static uint32_t ring_buf[RINGSIZE];
+static spsc_t ring;
+static atomic_u32_t finished;
+
+static uint32_t passed = 0;
+static pool_stats_t msg_stats;
+
+// The allocator pools replace, first fit over a table of blocks
+static struct {
+    msg_t blocks[NBENCH];
+    uint8_t used[NBENCH];
+} naive;
+
+static void *naive_alloc() {
+    uint32_t mie = irq_save();
+    void *b = 0;
+
+    for (uint32_t i = 0; i < NBENCH; i++) {
+        if (!naive.used[i]) {
+            naive.used[i] = 1;
+            b = &naive.blocks[i];
+            break;
+        }
+    }
+    irq_restore(mie);
+    return b;
+}
+
+static void naive_free(void *b) {
+    uint32_t mie = irq_save();
+
+    naive.used[(msg_t *)b - naive.blocks] = 0;
+    irq_restore(mie);
+}
+
+static void _stamp(msg_t *m, uint32_t owner, uint32_t seq) {
+    m->owner = owner;
+    m->seq = seq;
+    for (uint32_t i = 0; i < 6; i++) {
+        m->payload[i] = seq + i;
+    }
+}
+
+static void _check(const msg_t *m, uint32_t owner, uint32_t seq) {
+    if (m->owner != owner || m->seq != seq) {
+        test_fail();
+    }
+    for (uint32_t i = 0; i < 6; i++) {
+        if (m->payload[i] != seq + i) {
+            test_fail();
+        }
+    }
+}
+
+static void stress() {
+    msg_t *own[OWN_BURST];
+    uint32_t v;
+    uint32_t seq = 0;
+
+    spsc_init(&ring, ring_buf, RINGSIZE);
+    launch_core1(producer);
+
+    while (passed < NMSGS) {
+        while (spsc_pop(&ring, &v)) {
+            _check((msg_t *)v, 1, passed++);
+            pool_free(&msg_pool, (msg_t *)v);
+        }
+        // the ring, both caches and this burst hold at most 41 blocks, so
+        // allocations never fail
+        for (uint32_t i = 0; i < OWN_BURST; i++) {
+            if (!(own[i] = POOL_NEW(msg_pool, msg_t))) {
+                test_fail();
+            }
+            _stamp(own[i], 0, seq + i);
+        }
+        for (uint32_t i = 0; i < OWN_BURST; i++) {
+            _check(own[i], 0, seq + i);
+            pool_free(&msg_pool, own[i]);
+        }
+        seq += OWN_BURST;
+    }
+    while (!atomic_u32_load(&finished))
+        ;
+    pool_stats(&msg_pool, &msg_stats);
+}
+
+static void pool_pair(bench_sample_t *s, void *arg) {
+    void *b;
+
+    (void)arg;
+    bench_begin(s);
+    b = pool_alloc(&bench_pool);
+    pool_free(&bench_pool, b);
+    bench_end(s);
+}
+
+static void naive_pair(bench_sample_t *s, void *arg) {
+    void *b;
+
+    (void)arg;
+    bench_begin(s);
+    b = naive_alloc();
+    naive_free(b);
+    bench_end(s);
+}
+
+static void pool_burst(bench_sample_t *s, void *arg) {
+    void *b[BURST];
+
+    (void)arg;
+    bench_begin(s);
+    for (uint32_t i = 0; i < BURST; i++) {
+        b[i] = pool_alloc(&bench_pool);
+    }
+    for (uint32_t i = 0; i < BURST; i++) {
+        pool_free(&bench_pool, b[i]);
+    }
+    bench_end(s);
+}
+
+static void naive_burst(bench_sample_t *s, void *arg) {
+    void *b[BURST];
+
+    (void)arg;
+    bench_begin(s);
+    for (uint32_t i = 0; i < BURST; i++) {
+        b[i] = naive_alloc();
+    }
+    for (uint32_t i = 0; i < BURST; i++) {
+        naive_free(b[i]);
+    }
+    bench_end(s);
+}
+
+int main() {
+    boot_init();
+    uart_init();
+    bench_init();
+
+    stress();
+
+    // the first BUSY blocks stay in use, so first fit scans past them
+    for (uint32_t i = 0; i < BUSY; i++) {
+        pool_alloc(&bench_pool);
+        naive_alloc();
+    }
+
+    bench_run("pool_pair", pool_pair, 0, RUNS, 0);
+    bench_run("naive_pair", naive_pair, 0, RUNS, 0);
+    bench_run("pool_burst", pool_burst, 0, RUNS, 0);
+    bench_run("naive_burst", naive_burst, 0, RUNS, 0);
+
+    bench_done();
+    breakpoint();
+
+    return 0;
+}
+
+void producer() {
+    msg_t *m;
+
+    for (uint32_t i = 0; i < NMSGS; i++) {
+        while (!(m = POOL_NEW(msg_pool, msg_t)))
+            ;
+        _stamp(m, 1, i);
+        while (!spsc_push(&ring, (uint32_t)m))
+            ;
+    }
+    atomic_u32_store(&finished, 1);
+
+    while (1) {
+        asm volatile("wfi");
+    }
+}
@@ -0,0 +1,48 @@
+/**
+ * @brief Benchmarks the cost of a context switch in cycles (mcycle).
+ *
+ * Two U-mode tasks of equal priority yield to one another in a loop, so
+ * every sample in the scheduler stats is a full yield-to-yield round trip:
+ * ecall, forced timer interrupt, context save, scheduling decision and
+ * context restore. Both tasks are pinned to core 0, otherwise core 1 would
+ * steal one of them and neither would ever switch.
+ *
+ * After ITERATIONS yields, `ping` hits an ebreak. Inspect the stats with
+ * `p *sched_stats(0)`; the average cost is total / (switches - 1).
+ *
+ * @author Herbie Rand
+ */
+#include "clock.h"
+#include "sched.h"
+#include "task.h"
+#include "types.h"
+
+#define ITERATIONS 1000
+
+void ping();
+void pong();
+
+int main() {
+    clock_defaults_set();
+
+    sched_pin(sched_spawn(ping, 1));
+    sched_pin(sched_spawn(pong, 1));
+    sched_start();
+
+    // should never reach here
+    return 0;
+}
+
+void ping() {
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        task_yield();
+    }
+    asm volatile("ebreak");
+    task_exit();
+}
+
+void pong() {
+    while (1) {
+        task_yield();
+    }
+}
@@ -0,0 +1,105 @@
+/**
+ * @brief Tests that sleep_us gives up the CPU instead of spinning.
+ *
+ * First without the scheduler: a U-mode call to sleep_us of NAP_US waits
+ * in wfi, while a periodic kernel timer of TICK_US keeps firing. At the
+ * first breakpoint, expect napped >= NAP_US and ticks close to
+ * NAP_US / TICK_US; a spinning sleep would leave ticks at 0.
+ *
+ * Then under the scheduler, both tasks pinned to core 0: `sleeper` sleeps
+ * SLEEP_US at a time, and the lower priority `worker` counts meanwhile.
+ * After ITERATIONS sleeps, `sleeper` hits an ebreak. Expect worker_count
+ * to have advanced, `p *sched_stats(0)` to show switches >= 2 * ITERATIONS,
+ * and the sleeper's locals early == 0, with late the most it overslept in
+ * microseconds.
+ *
+ * @author Herbie Rand
+ */
+#include "asm.h"
+#include "clock.h"
+#include "mtime.h"
+#include "riscv.h"
+#include "sched.h"
+#include "task.h"
+#include "time.h"
+#include "timer.h"
+#include "types.h"
+#include "usys.h"
+
+#define NAP_US     10000
+#define TICK_US    1000
+#define SLEEP_US   2000
+#define ITERATIONS 100
+
+extern uint32_t __ustack0_base;
+
+void user_nap(uint32_t us);
+void sleeper();
+void worker();
+
+static ktimer_t tick;
+static uint32_t ticks = 0;
+static uint32_t napped = 0;
+
+static void _tick(void *arg) {
+    (void)arg;
+    ticks++;
+    timer_start(&tick, tick.deadline + us_to_ticks(TICK_US), _tick, 0);
+}
+
+int main() {
+    clock_defaults_set();
+    pmp_user_init();
+
+    timer_start(&tick, mtime_read() + us_to_ticks(TICK_US), _tick, 0);
+    set_mie(MTI_MASK);
+    napped = (uint32_t)user_call(user_nap, NAP_US, (uint32_t)&__ustack0_base);
+    timer_cancel(&tick);
+    if (napped < NAP_US || !ticks) {
+        test_fail();
+    }
+    breakpoint();
+
+    sched_pin(sched_spawn(sleeper, 2));
+    sched_pin(sched_spawn(worker, 1));
+    sched_start();
+
+    // should never reach here
+    return 0;
+}
+
+// Runs in U-mode, returns how long sleep_us took in microseconds
+void user_nap(uint32_t us) {
+    uint64_t t = now_us();
+
+    sleep_us(us);
+    user_return((uint32_t)(now_us() - t), 0);
+}
+
+void sleeper() {
+    uint32_t early = 0;
+    uint32_t late = 0;
+    uint32_t took;
+    uint64_t t;
+
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        t = now_us();
+        sleep_us(SLEEP_US);
+        took = (uint32_t)(now_us() - t);
+        if (took < SLEEP_US) {
+            early++;
+        } else if (took - SLEEP_US > late) {
+            late = took - SLEEP_US;
+        }
+    }
+    asm volatile("ebreak");
+    task_exit();
+}
+
+void worker() {
+    volatile uint32_t worker_count = 0;
+
+    while (1) {
+        worker_count++;
+    }
+}
@@ -0,0 +1,68 @@
+/**
+ * @brief Measures task throughput with both cores scheduling.
+ *
+ * NTASKS CPU-bound U-mode tasks of equal priority are all spawned on core 0.
+ * Core 1 starts with an empty queue and steals them from core 0 whenever it
+ * runs out of work. A timer on core 0 polls until every task has exited.
+ *
+ * At the final breakpoint, elapsed holds the wall time of the whole run in
+ * mcycle. Rebuild with SCHED_CORES set to 1 (sched.h) for the single core
+ * baseline; expect close to half of it with 2 cores. `p *sched_stats(1)`
+ * shows how many tasks core 1 stole.
+ *
+ * @author Herbie Rand
+ */
+#include "asm.h"
+#include "clock.h"
+#include "mtime.h"
+#include "riscv.h"
+#include "sched.h"
+#include "task.h"
+#include "timer.h"
+#include "types.h"
+
+#define NTASKS  6
+#define WORK    4000000
+#define POLL_US 1000
+
+void worker();
+
+static ktimer_t poll;
+static uint32_t start;
+static uint32_t elapsed;
+
+static void done(void *arg) {
+    (void)arg;
+    if (sched_live()) {
+        timer_start(&poll, poll.deadline + us_to_ticks(POLL_US), done, 0);
+        return;
+    }
+    elapsed = csr_read(mcycle) - start;
+    breakpoint();
+}
+
+int main() {
+    clock_defaults_set();
+
+    for (uint32_t i = 0; i < NTASKS; i++) {
+        sched_spawn(worker, 1);
+    }
+    start = csr_read(mcycle);
+    timer_start(&poll, mtime_read() + us_to_ticks(POLL_US), done, 0);
+    sched_start();
+
+    // should never reach here
+    return 0;
+}
+
+void worker() {
+    // xorshift, so the loop cannot be folded away
+    volatile uint32_t x = 1;
+
+    for (uint32_t i = 0; i < WORK; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+    }
+    task_exit();
+}
@@ -0,0 +1,107 @@
+/**
+ * @brief Stress tests spinlocks across both cores and an ISR.
+ *
+ * Both cores increment plain (non-atomic) counters, hw_count under a lock
+ * backed by an SIO hardware spinlock and ticket_count under a ticket lock,
+ * with a read-modify-write spread out so that any overlap loses updates.
+ * On core 0, the mtimer ISR also increments ticket_count, so core 0 takes
+ * that lock with interrupts off.
+ *
+ * At the final breakpoint, expect hw_count == 2 * NITERS and ticket_count
+ * == 2 * NITERS + NTICKS. Build with SPINLOCK_STATS=1 and inspect
+ * `p *spinlock_stats(&ticket)` for contention and hold times.
+ *
+ * @author Herbie Rand
+ */
+#include "asm.h"
+#include "atomic.h"
+#include "clock.h"
+#include "mtime.h"
+#include "runtime.h"
+#include "spinlock.h"
+#include "types.h"
+
+#define NITERS 100000
+#define NTICKS 2000
+
+void core1();
+void isr_mtimer_irq();
+
+static spinlock_t hw;
+static spinlock_t ticket;
+
+static volatile uint32_t hw_count = 0;
+static volatile uint32_t ticket_count = 0;
+static volatile uint32_t ticks = 0;
+static atomic_u32_t finished;
+
+static void _increment(volatile uint32_t *count) {
+    uint32_t v = *count;
+
+    for (volatile uint32_t i = 0; i < 4; i++)
+        ;
+    *count = v + 1;
+}
+
+int main() {
+    uint32_t mie;
+
+    clock_defaults_set();
+    spinlock_init(&hw);
+    spinlock_init_ticket(&ticket);
+    if (!hw.hw || ticket.hw) {
+        test_fail();
+    }
+
+    mtimer_enable();
+    mtimer_start(50);
+    launch_core1(core1);
+
+    for (uint32_t i = 0; i < NITERS; i++) {
+        spinlock_lock(&hw);
+        _increment(&hw_count);
+        spinlock_unlock(&hw);
+
+        mie = spinlock_lock_irqsave(&ticket);
+        _increment(&ticket_count);
+        spinlock_unlock_irqrestore(&ticket, mie);
+    }
+    while (!atomic_u32_load(&finished) || ticks < NTICKS)
+        ;
+
+    if (hw_count != 2 * NITERS || ticket_count != 2 * NITERS + NTICKS) {
+        test_fail();
+    }
+    breakpoint();
+
+    return 0;
+}
+
+void core1() {
+    for (uint32_t i = 0; i < NITERS; i++) {
+        spinlock_lock(&hw);
+        _increment(&hw_count);
+        spinlock_unlock(&hw);
+
+        // trylock must never succeed while the other side holds it
+        while (!spinlock_trylock(&ticket))
+            ;
+        _increment(&ticket_count);
+        spinlock_unlock(&ticket);
+    }
+    atomic_u32_store(&finished, 1);
+
+    while (1) {
+        asm volatile("wfi");
+    }
+}
+
+void isr_mtimer_irq() {
+    spinlock_lock(&ticket);
+    _increment(&ticket_count);
+    spinlock_unlock(&ticket);
+
+    if (++ticks < NTICKS) {
+        mtimer_start(50);
+    }
+}
@@ -0,0 +1,110 @@
+/**
+ * @brief Benchmarks the null syscall round trip in cycles (mcycle).
+ *
+ * The generic exception path is measured first, from M-mode: an ecall there
+ * is mcause 11, so it goes through isr_exc like every syscall used to, with
+ * all caller-saved registers spilled into an exception_frame_t, a dispatch
+ * through __exception_table and another through a handler table, and an
+ * out of line inc_mepc. isr_env_mmode_exc below reproduces that dispatch.
+ *
+ * Then a U-mode task makes the same number of null syscalls through
+ * null_syscall, which take the isr_ecall fast path.
+ *
+ * At the ebreak in `bench`, compare `p slow` (min and average cycles via
+ * the generic path, recorded by main) with `p fast` (same, via the fast
+ * path). Samples include the timing overhead itself, so compare the minima.
+ *
+ * @author Herbie Rand
+ */
+#include "asm.h"
+#include "clock.h"
+#include "riscv.h"
+#include "sched.h"
+#include "sys.h"
+#include "syscall.h"
+#include "task.h"
+#include "types.h"
+#include "usys.h"
+
+#define ITERATIONS 1000
+
+typedef struct {
+    uint32_t min;
+    uint32_t avg;
+} result_t;
+
+void bench();
+void isr_env_mmode_exc(exception_frame_t *sf);
+
+static void legacy_null(exception_frame_t *sf);
+
+static void (*legacy_table[])(exception_frame_t *) = {
+    [SYS_NULL] legacy_null,
+};
+
+static result_t slow;
+
+int main() {
+    register uint32_t a7 asm("a7") = SYS_NULL;
+    uint32_t start;
+    uint32_t delta;
+    uint32_t total = 0;
+
+    clock_defaults_set();
+    slow.min = MAX_UINT32;
+
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        start = csr_read(mcycle);
+        asm volatile("ecall" : : "r"(a7) : "memory");
+        delta = csr_read(mcycle) - start;
+        total += delta;
+        if (delta < slow.min) {
+            slow.min = delta;
+        }
+    }
+    slow.avg = total / ITERATIONS;
+
+    // let U-mode read cycle (CY) and instret (IR)
+    csr_write(mcounteren, 0x5);
+
+    sched_pin(sched_spawn(bench, 1));
+    sched_start();
+
+    // should never reach here
+    return 0;
+}
+
+void bench() {
+    // U-mode cannot write kernel data, so results stay on the task stack
+    result_t fast = {MAX_UINT32, 0};
+    uint32_t start;
+    uint32_t delta;
+    uint32_t total = 0;
+
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        start = csr_read(cycle);
+        null_syscall();
+        delta = csr_read(cycle) - start;
+        total += delta;
+        if (delta < fast.min) {
+            fast.min = delta;
+        }
+    }
+    fast.avg = total / ITERATIONS;
+
+    asm volatile("ebreak");
+    task_exit();
+}
+
+// The syscall path before isr_ecall, for comparison
+void isr_env_mmode_exc(exception_frame_t *sf) {
+    if (sf->a7 >= SYSCALL_COUNT) {
+        test_fail();
+    }
+    legacy_table[sf->a7](sf);
+    inc_mepc();
+}
+
+static void legacy_null(exception_frame_t *sf) {
+    (void)sf;
+}
@@ -0,0 +1,77 @@
+/**
+ * @brief Stress tests the timer service with many outstanding timers.
+ *
+ * Arms NTIMERS timers with pseudo-random deadlines spread over every level
+ * of the timer wheel (and beyond it), then sleeps until all have fired.
+ * A timer that fires before its deadline fails the test immediately.
+ *
+ * At the final breakpoint, expect fired == NTIMERS. max_late is the worst
+ * lateness in mtime ticks, which includes interrupt entry and the time
+ * spent firing earlier timers of the same granule.
+ *
+ * @author Herbie Rand
+ */
+#include "asm.h"
+#include "clock.h"
+#include "mtime.h"
+#include "timer.h"
+#include "types.h"
+
+#define NTIMERS 256
+
+void expire(void *arg);
+uint32_t rand();
+
+static ktimer_t timers[NTIMERS];
+static uint32_t seed = 0x2545f491;
+static uint32_t fired = 0;
+static uint64_t max_late = 0;
+
+int main() {
+    uint64_t now;
+    uint32_t mie;
+
+    clock_defaults_set();
+    mtimer_enable();
+
+    now = mtime_read();
+    for (uint32_t i = 0; i < NTIMERS; i++) {
+        // mostly short deadlines, some far beyond the wheel's range
+        uint32_t shift = rand() % 28;
+        timer_start(&timers[i], now + (rand() & ((1UL << shift) - 1)),
+                    expire, &timers[i]);
+    }
+    // re-arming and cancelling must also keep the wheel consistent
+    mie = irq_save();
+    timer_start(&timers[0], now + 1000, expire, &timers[0]);
+    if (timers[1].active) {
+        timer_cancel(&timers[1]);
+        fired++;
+    }
+    irq_restore(mie);
+
+    while (fired < NTIMERS) {
+        asm volatile("wfi");
+    }
+    breakpoint();
+
+    return 0;
+}
+
+void expire(void *arg) {
+    ktimer_t *t = (ktimer_t *)arg;
+    uint64_t now = mtime_read();
+
+    if (now < t->deadline) {
+        test_fail();
+    }
+    if (now - t->deadline > max_late) {
+        max_late = now - t->deadline;
+    }
+    fired++;
+}
+
+uint32_t rand() {
+    seed = seed * 1103515245 + 12345;
+    return seed >> 1;
+}
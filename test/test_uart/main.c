@@ -17,7 +17,7 @@
 void print_tick();
 
 static uint32_t tick = 0;
-static uint32_t us = 10000000;
+static uint32_t us = 1000000;
 static char buf[10];
 
 int main() {
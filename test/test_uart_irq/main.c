@@ -0,0 +1,94 @@
+/**
+ * @brief Compares polled and interrupt-driven UART transmit.
+ *
+ * Sends the same NBYTES message twice, first polled, then through the TX
+ * ring. For each, records the wall-clock duration of the transfer and the
+ * cycles the CPU was busy during it. In interrupt-driven mode the CPU is idle
+ * (in wfi) whenever it waits for the UART, so busy only counts the enqueue
+ * and the UART0 interrupts.
+ *
+ * Both transfers are timed until the last byte has entered the TX FIFO, the
+ * final FIFO's worth drains on its own.
+ *
+ * At the final breakpoint, expect polled.busy == polled.wall and irq.busy a
+ * small fraction of irq.wall, with both walls close to
+ * (NBYTES - UART_FIFO_DEPTH) * 10 / 115200 seconds. rate is the achieved
+ * throughput in bytes per second.
+ *
+ * @author Herbie Rand
+ */
+#include "asm.h"
+#include "clock.h"
+#include "mtime.h"
+#include "resets.h"
+#include "riscv.h"
+#include "rp2350.h"
+#include "types.h"
+#include "uart.h"
+
+#define NBYTES 512
+
+typedef struct {
+    uint32_t wall;
+    uint32_t busy;
+    uint32_t rate;
+} result_t;
+
+void fill();
+
+static char msg[NBYTES];
+static result_t polled;
+static result_t irq;
+
+int main() {
+    uint32_t start;
+    uint32_t idle = 0;
+    uint32_t t;
+    uint32_t mie;
+
+    initial_reset_cycle();
+    clock_defaults_set();
+    postclk_reset_cycle();
+    uart_init();
+    fill();
+
+    // polled, the CPU is busy for the whole transfer
+    start = csr_read(mcycle);
+    uart_write(msg, NBYTES);
+    polled.wall = csr_read(mcycle) - start;
+    polled.busy = polled.wall;
+    uart_flush();
+
+    // interrupt-driven, count the cycles spent asleep
+    uart_irq_enable(UARTIFLS_1_2, UARTIFLS_1_4);
+    start = csr_read(mcycle);
+    uart_write(msg, NBYTES);
+    for (;;) {
+        // interrupts off around wfi, so idle excludes the handler itself
+        mie = irq_save();
+        if (!(AT(UART0_UARTIMSC) & UARTINT_TX)) {
+            irq_restore(mie);
+            break;
+        }
+        t = csr_read(mcycle);
+        asm volatile("wfi");
+        idle += csr_read(mcycle) - t;
+        irq_restore(mie);
+    }
+    irq.wall = csr_read(mcycle) - start;
+    irq.busy = irq.wall - idle;
+    uart_flush();
+
+    polled.rate = NBYTES * 1000000 / (uint32_t)cycles_to_us(polled.wall);
+    irq.rate = NBYTES * 1000000 / (uint32_t)cycles_to_us(irq.wall);
+
+    breakpoint();
+
+    return 0;
+}
+
+void fill() {
+    for (uint32_t i = 0; i < NBYTES; i++) {
+        msg[i] = (i % 64 == 63) ? '\n' : 'a' + (i % 26);
+    }
+}
@@ -0,0 +1,172 @@
+/**
+ * @brief Benchmarks batched syscalls through the rings against one ecall
+ *        per syscall, and reports over the UART.
+ *
+ * Cases, each BATCH null syscalls made from U-mode and timed there:
+ * - ecall: BATCH calls to null_syscall
+ * - uring_enter: BATCH SQEs, one uring_enter, then BATCH CQEs popped
+ * - uring_poll: the same without any ecall, the kernel drains the ring
+ *   every POLL_US, so this is mostly the wait for the next poll
+ *
+ * Beforehand, batches of null and refused syscalls check the results that
+ * come back. Afterwards, the polled ring must refuse SYS_SPIN_MS, and a
+ * torn down ring must no longer be drained. At the final breakpoint, expect
+ * checked == 1 and errors == 0, or else the test fails; errors counts CQEs
+ * out of order or with a wrong result.
+ *
+ * Capture the report with `make console REPORT=uring.csv`.
+ *
+ * @author Herbie Rand
+ */
+#include "asm.h"
+#include "batch.h"
+#include "bench.h"
+#include "boot.h"
+#include "riscv.h"
+#include "sys.h"
+#include "syscall.h"
+#include "types.h"
+#include "uart.h"
+#include "usys.h"
+
+#define BATCH   URING_ENTRIES
+#define POLL_US 50
+#define RUNS    200
+
+extern uint32_t __ustack0_base;
+
+void user_ops(uint32_t arg);
+void user_ecall(uint32_t arg);
+void user_uring(uint32_t arg);
+void user_poll(uint32_t arg);
+void user_poll_spin(uint32_t arg);
+
+static uring_t *ring;
+static uint32_t checked = 0;
+static uint32_t errors = 0;
+
+static void run(bench_sample_t *s, void *arg) {
+    uint64_t r;
+
+    r = user_call((void (*)(uint32_t))arg, (uint32_t)ring,
+                  (uint32_t)&__ustack0_base);
+    s->cycles = (uint32_t)r;
+    s->instret = 0;
+    errors += (uint32_t)(r >> 32);
+}
+
+int main() {
+    uint64_t r;
+
+    boot_init();
+    uart_init();
+    bench_init();
+
+    ring = sys_uring_setup(0);
+
+    r = user_call(user_ops, (uint32_t)ring, (uint32_t)&__ustack0_base);
+    checked = (uint32_t)r;
+    errors += (uint32_t)(r >> 32);
+
+    bench_run("ecall", run, user_ecall, RUNS, 0);
+    bench_run("uring_enter", run, user_uring, RUNS, 0);
+
+    sys_uring_teardown(ring);
+    ring = sys_uring_setup(POLL_US);
+    bench_run("uring_poll", run, user_poll, RUNS, 0);
+    r = user_call(user_poll_spin, (uint32_t)ring, (uint32_t)&__ustack0_base);
+    errors += (uint32_t)(r >> 32);
+
+    errors += sys_uring_teardown(ring) != 0;
+    errors += sys_uring_enter(ring) != 0 || sys_uring_teardown(ring) != -1;
+
+    bench_done();
+    if (checked != 1 || errors) {
+        test_fail();
+    }
+    breakpoint();
+
+    return 0;
+}
+
+// Runs in U-mode, returns 1 and the number of wrong results
+void user_ops(uint32_t arg) {
+    uring_t *r = (uring_t *)arg;
+    uring_cqe_t c[3];
+    uint32_t bad = 0;
+
+    uring_push(r, SYS_NULL, 0, 0, 1);
+    uring_push(r, SYS_TASK_YIELD, 0, 0, 2);
+    bad += uring_enter(r) != 2;
+    bad += !uring_pop(r, &c[0]) || c[0].user_data != 1;
+    bad += !uring_pop(r, &c[1]) || c[1].user_data != 2 || c[1].res != -1;
+
+    uring_push(r, SYS_NULL, 0, 0, 3);
+    bad += uring_enter(r) != 1;
+    bad += !uring_pop(r, &c[2]) || c[2].user_data != 3;
+    bad += uring_pop(r, &c[2]);
+
+    user_return(1, bad);
+}
+
+// Runs in U-mode, returns the cycles of BATCH null syscalls
+void user_ecall(uint32_t arg) {
+    uint32_t c = csr_read(cycle);
+
+    (void)arg;
+    for (uint32_t i = 0; i < BATCH; i++) {
+        null_syscall();
+    }
+    c = csr_read(cycle) - c;
+    user_return(c, 0);
+}
+
+// Queues BATCH null syscalls, optionally enters, then waits for all of
+// them to complete, returning how many completed out of order
+static uint32_t _batch(uring_t *r, uint32_t enter) {
+    uring_cqe_t e;
+    uint32_t bad = 0;
+
+    for (uint32_t i = 0; i < BATCH; i++) {
+        uring_push(r, SYS_NULL, 0, 0, i);
+    }
+    if (enter) {
+        uring_enter(r);
+    }
+    for (uint32_t i = 0; i < BATCH; i++) {
+        while (!uring_pop(r, &e))
+            ;
+        bad += e.user_data != i;
+    }
+    return bad;
+}
+
+// Runs in U-mode, returns the cycles of BATCH null syscalls through the
+// ring, and the number of completions out of order
+void user_uring(uint32_t arg) {
+    uint32_t c = csr_read(cycle);
+    uint32_t bad = _batch((uring_t *)arg, 1);
+
+    c = csr_read(cycle) - c;
+    user_return(c, bad);
+}
+
+// Same as user_uring, without the ecall
+void user_poll(uint32_t arg) {
+    uint32_t c = csr_read(cycle);
+    uint32_t bad = _batch((uring_t *)arg, 0);
+
+    c = csr_read(cycle) - c;
+    user_return(c, bad);
+}
+
+// Runs in U-mode, returns 1 if the polled ring refused to spin
+void user_poll_spin(uint32_t arg) {
+    uring_t *r = (uring_t *)arg;
+    uring_cqe_t e;
+
+    uring_push(r, SYS_SPIN_MS, 500, 0, 1);
+    while (!uring_pop(r, &e))
+        ;
+    user_return(0, e.user_data != 1 || e.res != -1);
+}
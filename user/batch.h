@@ -0,0 +1,94 @@
+/**
+ * @file batch.h
+ * @brief Batched syscalls, through the rings of include/uring.h.
+ *
+ * Get a ring from uring_setup. Queue syscalls with uring_push, run them
+ * all with one uring_enter, or let the kernel poll the ring, and collect
+ * the results with uring_pop. Hand the ring back with uring_teardown once
+ * done; a task's rings are torn down when it exits.
+ *
+ *     uring_t *r = uring_setup(0);
+ *
+ *     uring_push(r, SYS_LED_ON, 0, 0, 1);
+ *     uring_push(r, SYS_LED_OFF, 0, 0, 2);
+ *     uring_enter(r);
+ *     while (uring_pop(r, &c)) { ... }
+ *     uring_teardown(r);
+ *
+ * A polled ring refuses syscalls that hold up the core, such as
+ * SYS_SPIN_MS, since the kernel drains it from a timer interrupt.
+ */
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "sys.h"
+#include "types.h"
+#include "uring.h"
+
+/**
+ * @brief Sets up an empty ring, see sys_uring_setup.
+ * @param poll_us   Integer period at which the kernel drains the ring
+ *                  without being asked, or 0 to drain it on uring_enter
+ *                  only
+ * @returns The ring, or 0 if none is free
+ */
+uring_t *uring_setup(uint32_t poll_us);
+
+/**
+ * @brief Stops the kernel draining a ring, and frees it. The ring must not
+ *        be used afterwards.
+ * @returns 0, or -1 if r is not a ring in use
+ */
+int32_t uring_teardown(uring_t *r);
+
+/**
+ * @brief Runs the queued syscalls, with a single ecall.
+ * @returns Integer number of syscalls completed
+ */
+uint32_t uring_enter(uring_t *r);
+
+/**
+ * @brief Queues a syscall.
+ * @param r         Ring
+ * @param op        Syscall number, e.g. SYS_LED_ON
+ * @param a0        First argument
+ * @param a1        Second argument
+ * @param user_data Integer copied into the completion
+ * @returns 1 if queued, 0 if the ring is full
+ */
+static __inline uint32_t uring_push(uring_t *r, uint32_t op, uint32_t a0,
+                                    uint32_t a1, uint32_t user_data) {
+    uint32_t tail = r->sq_tail;
+    uring_sqe_t *e;
+
+    if (tail - __atomic_load_n(&r->sq_head, __ATOMIC_ACQUIRE) ==
+        URING_ENTRIES) {
+        return 0;
+    }
+    e = &r->sq[tail & (URING_ENTRIES - 1)];
+    e->op = op;
+    e->a0 = a0;
+    e->a1 = a1;
+    e->user_data = user_data;
+    __atomic_store_n(&r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+/**
+ * @brief Takes the oldest completion.
+ * @param r     Ring
+ * @param c     Filled in with the completion
+ * @returns 1 if there was one, 0 otherwise
+ */
+static __inline uint32_t uring_pop(uring_t *r, uring_cqe_t *c) {
+    uint32_t head = r->cq_head;
+
+    if (head == __atomic_load_n(&r->cq_tail, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+    *c = r->cq[head & (URING_ENTRIES - 1)];
+    __atomic_store_n(&r->cq_head, head + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+#endif
@@ -0,0 +1,61 @@
+/**
+ * @file heap.c
+ * @brief Implements the user heap on top of TLSF, see user/heap.h.
+ * @author Herbie Rand
+ */
+
+#include "heap.h"
+#include "time.h"
+#include "tlsf.h"
+#include "types.h"
+
+// how long a contended malloc or free waits before trying again
+#define BACKOFF_US 10
+
+extern uint8_t __uheap_free;
+extern uint8_t __uheap_end;
+
+typedef struct {
+    uint32_t lock;
+    tlsf_t tlsf;
+} uheap_t;
+
+// first thing in .uheap, so U-mode may write it; zeroed at boot, and set up
+// by the first malloc
+__attribute__((section(".uheap"))) static uheap_t uheap;
+
+static void _lock();
+static void _unlock();
+
+void *malloc(__SIZE_TYPE__ size) {
+    void *p;
+
+    _lock();
+    if (!uheap.tlsf.first) {
+        tlsf_init(&uheap.tlsf, &__uheap_free, &__uheap_end - &__uheap_free);
+    }
+    p = tlsf_alloc(&uheap.tlsf, size);
+    _unlock();
+    return p;
+}
+
+void free(void *p) {
+    if (!p) {
+        return;
+    }
+    _lock();
+    tlsf_free(&uheap.tlsf, p);
+    _unlock();
+}
+
+// The holder may be a preempted task of lower priority on this core, which
+// spinning would starve, so a contended lock sleeps instead.
+static void _lock() {
+    while (__atomic_exchange_n(&uheap.lock, 1, __ATOMIC_ACQUIRE)) {
+        sleep_us(BACKOFF_US);
+    }
+}
+
+static void _unlock() {
+    __atomic_store_n(&uheap.lock, 0, __ATOMIC_RELEASE);
+}
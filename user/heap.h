@@ -0,0 +1,24 @@
+#ifndef HEAP_H
+#define HEAP_H
+
+#include "types.h"
+
+/**
+ * @brief Allocates from the user heap, in bounded time whatever the heap's
+ *        state, see user/tlsf.h. Runs entirely in U-mode, without a trap,
+ *        unless another task holds the heap's lock, in which case it sleeps.
+ * @param size  Integer bytes, a size_t as the compiler's builtin malloc
+ *              expects
+ * @returns Pointer to the block, 8-byte aligned, or 0 if the heap has no
+ *          room
+ */
+void *malloc(__SIZE_TYPE__ size);
+
+/**
+ * @brief Returns a block to the user heap, in bounded time. Hits a
+ *        breakpoint on most bad pointers, see tlsf_free.
+ * @param p     Block from malloc, or 0 to do nothing
+ */
+void free(void *p);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include "types.h"
+
+/**
+ * @brief Creates a task, making the caller a task too if it is not already.
+ * @param entry Task entry point. Tasks must not return, use task_exit.
+ * @param prio  Integer priority, higher preempts lower
+ * @returns Integer task id, or -1 if no slot is free
+ */
+int32_t task_create(void (*entry)(), uint32_t prio);
+
+/**
+ * @brief Gives up the CPU to another ready task of equal or higher priority.
+ */
+void task_yield();
+
+/**
+ * @brief Terminates the calling task.
+ */
+void task_exit();
+
+#endif
@@ -0,0 +1,45 @@
+/**
+ * @file time.c
+ * @brief Time for U-mode: trap-free reads and sleeps, see user/time.h.
+ * @author Herbie Rand
+ */
+
+#include "time.h"
+#include "timebase.h"
+#include "types.h"
+
+#define MTIME  (*(volatile uint32_t *)TIMEBASE_MTIME)
+#define MTIMEH (*(volatile uint32_t *)TIMEBASE_MTIMEH)
+
+void sleep_ms(uint32_t ms) {
+    // in steps, so the microseconds fit in 32 bits
+    for (; ms > 1000000; ms -= 1000000) {
+        sleep_us(1000000000);
+    }
+    sleep_us(ms * 1000);
+}
+
+uint64_t now_ticks() {
+    uint32_t hi;
+    uint32_t lo;
+
+    // the low word may carry into the high one between the two reads
+    do {
+        hi = MTIMEH;
+        lo = MTIME;
+    } while (hi != MTIMEH);
+    return ((uint64_t)hi << 32) | lo;
+}
+
+uint64_t now_us() {
+    uint64_t t = now_ticks();
+
+#if MTIME_TICKS_PER_US & (MTIME_TICKS_PER_US - 1)
+    // t * (2^32 / MTIME_TICKS_PER_US) >> 32, without a libgcc division
+    uint32_t m = MAX_UINT32 / MTIME_TICKS_PER_US + 1;
+
+    return (uint64_t)(uint32_t)(t >> 32) * m + (((t & MAX_UINT32) * m) >> 32);
+#else
+    return t / MTIME_TICKS_PER_US;
+#endif
+}
@@ -3,6 +3,35 @@
 
 #include "types.h"
 
+/**
+ * @brief Busy-waits, with interrupts held off throughout. Prefer sleep_ms.
+ */
 void spin_ms(uint32_t);
 
+/**
+ * @brief Sleeps for at least us microseconds. Other tasks run meanwhile,
+ *        or the core idles, and interrupts are taken as usual.
+ * @param us    Integer microseconds
+ */
+void sleep_us(uint32_t us);
+
+/**
+ * @brief Sleeps for at least ms milliseconds, see sleep_us.
+ * @param ms    Integer milliseconds
+ */
+void sleep_ms(uint32_t ms);
+
+/**
+ * @brief Reads the 64-bit mtime counter straight from U-mode, without a
+ *        trap. Ticks at MTIME_TICKS_PER_US, see timebase.h.
+ * @returns Integer mtime
+ */
+uint64_t now_ticks();
+
+/**
+ * @brief Microseconds since mtime started, read without a trap.
+ * @returns Integer microseconds
+ */
+uint64_t now_us();
+
 #endif
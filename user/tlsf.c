@@ -0,0 +1,264 @@
+/**
+ * @file tlsf.c
+ * @brief Implements the TLSF heap, see tlsf.h.
+ * @author Herbie Rand
+ */
+
+#include "tlsf.h"
+#include "types.h"
+
+#define FREE 0x1
+
+#ifdef HOST
+// counted by the register model, see host/host.h
+void breakpoint();
+#else
+// built into user text, where the kernel's breakpoint() is out of reach
+#define breakpoint() asm volatile("ebreak")
+#endif
+
+#define HEADER_SIZE TLSF_OVERHEAD
+// room for the free links, which overlap the block itself
+#define MIN_SIZE (sizeof(tlsf_block_t) - HEADER_SIZE)
+
+// first level of TLSF_SMALL_SIZE is 1, level 0 holds the small sizes
+#define FL_SHIFT (TLSF_SL_LOG2 + 2)
+
+static void _mapping(uint32_t size, uint32_t *fl, uint32_t *sl);
+static tlsf_block_t *_find(tlsf_t *h, uint32_t fl, uint32_t sl);
+static void _insert(tlsf_t *h, tlsf_block_t *b);
+static void _remove(tlsf_t *h, tlsf_block_t *b);
+static void _split(tlsf_t *h, tlsf_block_t *b, uint32_t size);
+
+static __inline uint32_t _fls(uint32_t x) {
+    return 31 - __builtin_clz(x);
+}
+
+static __inline uint32_t _size(const tlsf_block_t *b) {
+    return b->size & ~FREE;
+}
+
+static __inline tlsf_block_t *_next(const tlsf_block_t *b) {
+    return (tlsf_block_t *)((uint8_t *)b + HEADER_SIZE + _size(b));
+}
+
+void tlsf_init(tlsf_t *h, void *mem, uint32_t size) {
+    uint32_t pad = -(uint32_t)mem & (TLSF_ALIGN - 1);
+    tlsf_block_t *b = (tlsf_block_t *)((uint8_t *)mem + pad);
+    tlsf_block_t *end;
+
+    // a free block, and the empty block that ends the heap
+    if (size < pad + 2 * HEADER_SIZE + MIN_SIZE) {
+        breakpoint();
+        return;
+    }
+    size = (size - pad) & ~(TLSF_ALIGN - 1);
+    if (size - 2 * HEADER_SIZE >= 1u << TLSF_FL_MAX) {
+        breakpoint();
+        return;
+    }
+
+    h->fl_bitmap = 0;
+    for (uint32_t fl = 0; fl < TLSF_FL_COUNT; fl++) {
+        h->sl_bitmap[fl] = 0;
+        for (uint32_t sl = 0; sl < TLSF_SL_COUNT; sl++) {
+            h->lists[fl][sl] = 0;
+        }
+    }
+    h->first = b;
+    h->size = size;
+    h->used = 0;
+    h->high_water = 0;
+    h->allocs = 0;
+    h->frees = 0;
+    h->failures = 0;
+
+    b->prev_phys = 0;
+    b->size = (size - 2 * HEADER_SIZE) | FREE;
+    end = _next(b);
+    end->prev_phys = b;
+    end->size = 0;
+    _insert(h, b);
+}
+
+void *tlsf_alloc(tlsf_t *h, uint32_t size) {
+    uint32_t search;
+    uint32_t fl;
+    uint32_t sl;
+    tlsf_block_t *b;
+
+    if (size > TLSF_MAX_ALLOC) {
+        h->failures++;
+        return 0;
+    }
+    size = (size + TLSF_ALIGN - 1) & ~(TLSF_ALIGN - 1);
+    if (size < MIN_SIZE) {
+        size = MIN_SIZE;
+    }
+
+    // round up to the next size class, so any block of the list fits
+    search = size;
+    if (search >= TLSF_SMALL_SIZE) {
+        search += (1 << (_fls(search) - TLSF_SL_LOG2)) - 1;
+    }
+    _mapping(search, &fl, &sl);
+    b = _find(h, fl, sl);
+    if (!b) {
+        h->failures++;
+        return 0;
+    }
+
+    _remove(h, b);
+    _split(h, b, size);
+    b->size &= ~FREE;
+
+    h->used += HEADER_SIZE + _size(b);
+    if (h->used > h->high_water) {
+        h->high_water = h->used;
+    }
+    h->allocs++;
+    return (uint8_t *)b + HEADER_SIZE;
+}
+
+void tlsf_free(tlsf_t *h, void *p) {
+    tlsf_block_t *b;
+    tlsf_block_t *n;
+
+    if (!p) {
+        return;
+    }
+    b = (tlsf_block_t *)((uint8_t *)p - HEADER_SIZE);
+    if ((uint8_t *)b < (uint8_t *)h->first ||
+        (uint8_t *)p >= (uint8_t *)h->first + h->size ||
+        ((uint32_t)p & (TLSF_ALIGN - 1)) || (b->size & FREE)) {
+        breakpoint();
+        return;
+    }
+
+    h->used -= HEADER_SIZE + _size(b);
+    h->frees++;
+
+    // no two free blocks are ever adjacent, so there is at most one merge
+    // on either side
+    n = _next(b);
+    if (n->size & FREE) {
+        _remove(h, n);
+        b->size += HEADER_SIZE + _size(n);
+        _next(b)->prev_phys = b;
+    }
+    if (b->prev_phys && (b->prev_phys->size & FREE)) {
+        n = b;
+        b = b->prev_phys;
+        _remove(h, b);
+        b->size += HEADER_SIZE + _size(n);
+        _next(b)->prev_phys = b;
+    }
+    b->size |= FREE;
+    _insert(h, b);
+}
+
+void tlsf_stats(const tlsf_t *h, tlsf_stats_t *out) {
+    out->size = h->size;
+    out->used = h->used;
+    out->high_water = h->high_water;
+    out->free = 0;
+    out->largest_free = 0;
+    out->free_blocks = 0;
+    out->allocs = h->allocs;
+    out->frees = h->frees;
+    out->failures = h->failures;
+
+    for (tlsf_block_t *b = h->first; _size(b); b = _next(b)) {
+        if (!(b->size & FREE)) {
+            continue;
+        }
+        out->free += _size(b);
+        out->free_blocks++;
+        if (_size(b) > out->largest_free) {
+            out->largest_free = _size(b);
+        }
+    }
+}
+
+// Size class of a block: fl is the power of two, sl the linear step in it
+static void _mapping(uint32_t size, uint32_t *fl, uint32_t *sl) {
+    uint32_t f;
+
+    if (size < TLSF_SMALL_SIZE) {
+        *fl = 0;
+        *sl = size / TLSF_ALIGN;
+        return;
+    }
+    f = _fls(size);
+    *fl = f - FL_SHIFT;
+    *sl = (size >> (f - TLSF_SL_LOG2)) ^ TLSF_SL_COUNT;
+}
+
+// First block of the smallest non-empty list at or above [fl][sl]
+static tlsf_block_t *_find(tlsf_t *h, uint32_t fl, uint32_t sl) {
+    uint32_t map = h->sl_bitmap[fl] & (MAX_UINT32 << sl);
+
+    if (!map) {
+        map = h->fl_bitmap & (MAX_UINT32 << (fl + 1));
+        if (!map) {
+            return 0;
+        }
+        fl = __builtin_ctz(map);
+        map = h->sl_bitmap[fl];
+    }
+    return h->lists[fl][__builtin_ctz(map)];
+}
+
+static void _insert(tlsf_t *h, tlsf_block_t *b) {
+    uint32_t fl;
+    uint32_t sl;
+
+    _mapping(_size(b), &fl, &sl);
+    b->next_free = h->lists[fl][sl];
+    b->prev_free = 0;
+    if (b->next_free) {
+        b->next_free->prev_free = b;
+    }
+    h->lists[fl][sl] = b;
+    h->fl_bitmap |= 1u << fl;
+    h->sl_bitmap[fl] |= 1u << sl;
+}
+
+static void _remove(tlsf_t *h, tlsf_block_t *b) {
+    uint32_t fl;
+    uint32_t sl;
+
+    _mapping(_size(b), &fl, &sl);
+    if (b->prev_free) {
+        b->prev_free->next_free = b->next_free;
+    } else {
+        h->lists[fl][sl] = b->next_free;
+    }
+    if (b->next_free) {
+        b->next_free->prev_free = b->prev_free;
+    }
+    if (!h->lists[fl][sl]) {
+        h->sl_bitmap[fl] &= ~(1u << sl);
+        if (!h->sl_bitmap[fl]) {
+            h->fl_bitmap &= ~(1u << fl);
+        }
+    }
+}
+
+// Trims b, which is out of the lists, to size bytes, and frees the rest if
+// it is large enough to be a block. Its neighbour after is in use, since b
+// was free.
+static void _split(tlsf_t *h, tlsf_block_t *b, uint32_t size) {
+    uint32_t rest = _size(b) - size;
+    tlsf_block_t *r;
+
+    if (rest < HEADER_SIZE + MIN_SIZE) {
+        return;
+    }
+    b->size = size | (b->size & FREE);
+    r = _next(b);
+    r->prev_phys = b;
+    r->size = (rest - HEADER_SIZE) | FREE;
+    _next(r)->prev_phys = r;
+    _insert(h, r);
+}
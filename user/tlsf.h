@@ -0,0 +1,132 @@
+/**
+ * @file tlsf.h
+ * @brief Two-level segregated fit (TLSF) heap, for variable-size blocks in
+ *        bounded time.
+ *
+ * Free blocks are kept in lists by size class. The first level splits sizes
+ * by power of two, the second splits each power of two into TLSF_SL_COUNT
+ * linear steps; sizes below TLSF_SMALL_SIZE get one class per 8 bytes. A
+ * bitmap per level says which lists are non-empty, so finding a list that
+ * is certain to fit is two bit scans (clz/ctz, single Zbb instructions),
+ * and neither tlsf_alloc nor tlsf_free contains a loop. Freed blocks merge
+ * with free neighbours at once.
+ *
+ * A request is rounded up to the next size class before the lookup, so
+ * that any block in the list found fits. The cost is up to 1/16 of the
+ * request left unused, in exchange for never searching a list.
+ *
+ * Each block has an 8-byte header in front of it, holding its size and a
+ * pointer to the block before it in memory. A free block also links itself
+ * into its list with its first 8 bytes. Blocks are 8-byte aligned.
+ *
+ * A tlsf_t is not locked, callers that share one must serialize. Built
+ * into user text, so that the user heap runs entirely in U-mode, see
+ * user/heap.h: block headers and free links live in memory U-mode can
+ * write, and only code running with U-mode's privileges may follow them.
+ *
+ * @see M. Masmano et al., "TLSF: a New Dynamic Memory Allocator for
+ *      Real-Time Systems", ECRTS 2004
+ * @author Herbie Rand
+ */
+
+#ifndef TLSF_H
+#define TLSF_H
+
+#include "types.h"
+
+/** @brief log2 of the second-level lists per power of two */
+#define TLSF_SL_LOG2  4
+#define TLSF_SL_COUNT (1 << TLSF_SL_LOG2)
+/** @brief Block alignment and size granularity */
+#define TLSF_ALIGN 8
+/** @brief Sizes below this get one list per TLSF_ALIGN bytes */
+#define TLSF_SMALL_SIZE (TLSF_SL_COUNT * TLSF_ALIGN)
+/** @brief Blocks are smaller than 2^TLSF_FL_MAX bytes */
+#define TLSF_FL_MAX   24
+#define TLSF_FL_COUNT (TLSF_FL_MAX - TLSF_SL_LOG2 - 2)
+/** @brief Largest request tlsf_alloc accepts */
+#define TLSF_MAX_ALLOC (1 << (TLSF_FL_MAX - 1))
+
+typedef struct tlsf_block {
+    /** @brief Block before this one in memory, 0 for the first */
+    struct tlsf_block *prev_phys;
+    /** @brief Bytes after the header, bit 0 set if the block is free */
+    uint32_t size;
+    /** @brief Free list links, only in free blocks */
+    struct tlsf_block *next_free;
+    struct tlsf_block *prev_free;
+} tlsf_block_t;
+
+/** @brief Bytes in front of every block, prev_phys and size */
+#define TLSF_OVERHEAD __builtin_offsetof(tlsf_block_t, next_free)
+
+typedef struct {
+    /** @brief Bit fl is set if any list of first level fl is non-empty */
+    uint32_t fl_bitmap;
+    /** @brief Bit sl of entry fl is set if list [fl][sl] is non-empty */
+    uint32_t sl_bitmap[TLSF_FL_COUNT];
+    tlsf_block_t *lists[TLSF_FL_COUNT][TLSF_SL_COUNT];
+    /** @brief First block, the heap runs up to an empty block at the end */
+    tlsf_block_t *first;
+    uint32_t size;
+    /** @brief Bytes of allocated blocks, headers included */
+    uint32_t used;
+    uint32_t high_water;
+    uint32_t allocs;
+    uint32_t frees;
+    /** @brief Requests that found no block large enough */
+    uint32_t failures;
+} tlsf_t;
+
+typedef struct {
+    /** @brief Bytes managed, headers included */
+    uint32_t size;
+    /** @brief Bytes of allocated blocks, headers included */
+    uint32_t used;
+    /** @brief Most bytes ever used at once */
+    uint32_t high_water;
+    /** @brief Payload bytes of all free blocks */
+    uint32_t free;
+    /** @brief Payload bytes of the largest free block */
+    uint32_t largest_free;
+    uint32_t free_blocks;
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t failures;
+} tlsf_stats_t;
+
+/**
+ * @brief Initializes a heap over a region of memory, as one free block.
+ * Hits a breakpoint if the region is too small or too large to manage.
+ * @param h     Heap
+ * @param mem   Start of the region, rounded up to TLSF_ALIGN
+ * @param size  Integer bytes, headers included, below 2^TLSF_FL_MAX
+ */
+void tlsf_init(tlsf_t *h, void *mem, uint32_t size);
+
+/**
+ * @brief Allocates a block in bounded time.
+ * @param h     Heap
+ * @param size  Integer bytes, rounded up to TLSF_ALIGN
+ * @returns Pointer to the block, aligned to TLSF_ALIGN, or 0 if no free
+ *          block is large enough
+ */
+void *tlsf_alloc(tlsf_t *h, uint32_t size);
+
+/**
+ * @brief Frees a block in bounded time, merging it with free neighbours.
+ * Hits a breakpoint if p is outside the heap, and on most double frees.
+ * @param h     Heap p was allocated from
+ * @param p     Block, or 0 to do nothing
+ */
+void tlsf_free(tlsf_t *h, void *p);
+
+/**
+ * @brief Collects statistics. Walks every block, so unlike allocation it
+ *        takes time linear in the number of blocks.
+ * @param h     Heap
+ * @param out   Filled in with the statistics
+ */
+void tlsf_stats(const tlsf_t *h, tlsf_stats_t *out);
+
+#endif
@@ -0,0 +1,20 @@
+/**
+ * @brief Syscalls for testing and benchmarking the kernel itself.
+ */
+#ifndef USYS_H
+#define USYS_H
+
+#include "types.h"
+
+/**
+ * @brief Makes a syscall that does nothing, for measuring syscall overhead.
+ */
+void null_syscall();
+
+/**
+ * @brief Returns two words to the kernel code that entered U-mode through
+ *        user_call. Does not return.
+ */
+void user_return(uint32_t a0, uint32_t a1);
+
+#endif